@@ -1,156 +1,531 @@
+#include "libcpdl/cpdl.h"
 #include "stuff/Buffer.h"
 #include "stuff/FileLoader.h"
+#include "stuff/ObjectTable.h"
+#include "stuff/TypeRegistry.h"
+#include "stuff/FlatHashMap.h"
+#include "stuff/Morton.h"
+#include "stuff/ObjectFilter.h"
+#include "stuff/MapDiff.h"
+#include "stuff/Duplicates.h"
+#include "stuff/QuantizedTable.h"
+#include "stuff/ObjectText.h"
 
 #include <iostream>
 #include <iomanip>
 #include <fstream>
 #include <cstdint>
-#include <cstring>
 #include <vector>
-#include <cmath>
-#include <openssl/aes.h>
-#include <openssl/evp.h>
-
-struct PDLObject {
-    uint32_t type;
-    float x, y, z;
-    size_t offset;
+#include <algorithm>
+#include <unordered_map>
+#include <memory_resource>
+#include <chrono>
+
+// The command line is a front end over libcpdl.
+using namespace cpdl;
+
+// --- Command Line ---
+enum class Mode { Extract, Stats, Summary, Query, Diff, MakeDelta, ApplyDelta, Duplicates, Quantize, Import };
+enum class ObjectOrder { File, Morton };
+
+struct Options {
+    Mode mode = Mode::Extract;
+    ObjectOrder order = ObjectOrder::File;
+    bool groupByType = false;
+    ObjectFilter filter;
+    std::string inputFile = "map.pdl";
+    std::string outputFile;
+    std::string layoutsFile;
+    std::string typesFile;
+    std::string queriesFile;
+    std::string newerFile; // --diff and --make-delta
+    std::string deltaFile;
+    std::string importFile;
+    float tolerance = 0.001f;
+    unsigned quantizeBits = 21;
+    float moveRadius = 16.0f;
+    bool saveLayout = false;
+    bool ranged = false;
+    size_t offset = 0;
+    size_t limit = SIZE_MAX;
 };
 
-std::string getTypeName(uint32_t type) {
-    switch (type) {
-        case 3274399645: return "Vehicle";
-        default: return "Object";
-    }
+void printUsage() {
+    std::cout << "Usage: cpdl [options] [input.pdl] [output.txt]\n"
+              << "  --layouts <file>   known layout descriptors, skips detection on a signature match\n"
+              << "  --save-layout      append the detected layout to the --layouts file\n"
+              << "  --types <file>     type ID to name registry (see types.txt)\n"
+              << "  --offset <n>       first record to extract, by index from the header\n"
+              << "  --limit <n>        number of records to extract\n"
+              << "  --order <file|morton>  output order; morton sorts objects along a Z-order curve\n"
+              << "  --group-by-type    group objects by type ID, each group behind a count header\n"
+              << "  --type <id>[,<id>...]  keep only these type IDs (repeatable)\n"
+              << "  --box <min_x> <min_y> <min_z> <max_x> <max_y> <max_z>  keep only objects inside the box\n"
+              << "  --x|--y|--z <min> <max>  keep only objects inside the coordinate range\n"
+              << "  --stats            write per-type counts, bounds and unknown IDs (map_stats.txt)\n"
+              << "  --summary          write min/max/mean/variance of x, y, z overall and per type (map_summary.txt)\n"
+              << "  --queries <file>   answer box/radius/knn/nearest queries from a file (map_queries.txt)\n"
+              << "  --diff <new.pdl>   list objects added, removed or moved in new.pdl relative to the input (map_diff.txt)\n"
+              << "  --import <text>    re-encode extracted text into the input map's layout (map_imported.pdl)\n"
+              << "  --make-delta <new.pdl>  write a binary delta from the input to new.pdl (map.delta)\n"
+              << "  --apply-delta <file>    apply a delta to the input map (map_patched.pdl)\n"
+              << "  --quantize <16|21>  report memory and error of fixed-point coordinates (map_quantized.txt)\n"
+              << "  --duplicates       list identical and near-identical placements (map_duplicates.txt)\n"
+              << "  --tolerance <d>    diff: positions closer than this are unchanged; duplicates: near distance (default 0.001)\n"
+              << "  --move-radius <r>  diff: farthest distance an object is matched as moved (default 16)\n";
 }
 
-bool isReasonableCoord(float f) {
-    return std::abs(f) < 100000.0f;
+Options parseOptions(int argc, char** argv) {
+    Options options;
+    std::vector<std::string> positional;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc)
+                throw std::runtime_error("Missing value for " + arg);
+            return argv[++i];
+        };
+
+        if (arg == "--layouts") {
+            options.layoutsFile = value();
+        } else if (arg == "--order") {
+            std::string order = value();
+            if (order == "morton")
+                options.order = ObjectOrder::Morton;
+            else if (order != "file")
+                throw std::runtime_error("Unknown order " + order);
+        } else if (arg == "--group-by-type") {
+            options.groupByType = true;
+        } else if (arg == "--type") {
+            std::stringstream ids(value());
+            std::string id;
+            while (std::getline(ids, id, ','))
+                options.filter.addType(uint32_t(std::stoul(id)));
+        } else if (arg == "--box") {
+            Bounds box;
+            box.minX = std::stof(value());
+            box.minY = std::stof(value());
+            box.minZ = std::stof(value());
+            box.maxX = std::stof(value());
+            box.maxY = std::stof(value());
+            box.maxZ = std::stof(value());
+            options.filter.clampBox(box);
+        } else if (arg == "--x" || arg == "--y" || arg == "--z") {
+            const float min = std::stof(value());
+            const float max = std::stof(value());
+            if (arg == "--x")
+                options.filter.clampX(min, max);
+            else if (arg == "--y")
+                options.filter.clampY(min, max);
+            else
+                options.filter.clampZ(min, max);
+        } else if (arg == "--stats") {
+            options.mode = Mode::Stats;
+        } else if (arg == "--summary") {
+            options.mode = Mode::Summary;
+        } else if (arg == "--queries") {
+            options.mode = Mode::Query;
+            options.queriesFile = value();
+        } else if (arg == "--diff") {
+            options.mode = Mode::Diff;
+            options.newerFile = value();
+        } else if (arg == "--import") {
+            options.mode = Mode::Import;
+            options.importFile = value();
+        } else if (arg == "--make-delta") {
+            options.mode = Mode::MakeDelta;
+            options.newerFile = value();
+        } else if (arg == "--apply-delta") {
+            options.mode = Mode::ApplyDelta;
+            options.deltaFile = value();
+        } else if (arg == "--quantize") {
+            options.mode = Mode::Quantize;
+            options.quantizeBits = unsigned(std::stoul(value()));
+        } else if (arg == "--duplicates") {
+            options.mode = Mode::Duplicates;
+        } else if (arg == "--tolerance") {
+            options.tolerance = std::stof(value());
+        } else if (arg == "--move-radius") {
+            options.moveRadius = std::stof(value());
+        } else if (arg == "--types") {
+            options.typesFile = value();
+        } else if (arg == "--save-layout") {
+            options.saveLayout = true;
+        } else if (arg == "--offset") {
+            options.offset = std::stoull(value());
+            options.ranged = true;
+        } else if (arg == "--limit") {
+            options.limit = std::stoull(value());
+            options.ranged = true;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            throw std::runtime_error("Unknown option " + arg);
+        } else {
+            positional.push_back(arg);
+        }
+    }
+
+    if (positional.size() > 2)
+        throw std::runtime_error("Too many arguments");
+    if (positional.size() > 0)
+        options.inputFile = positional[0];
+    if (positional.size() > 1)
+        options.outputFile = positional[1];
+    if (options.outputFile.empty())
+        options.outputFile = options.mode == Mode::Stats ? "map_stats.txt"
+                           : options.mode == Mode::Summary ? "map_summary.txt"
+                           : options.mode == Mode::Query ? "map_queries.txt"
+                           : options.mode == Mode::Diff ? "map_diff.txt"
+                           : options.mode == Mode::Duplicates ? "map_duplicates.txt"
+                           : options.mode == Mode::Quantize ? "map_quantized.txt"
+                           : options.mode == Mode::MakeDelta ? "map.delta"
+                           : options.mode == Mode::Import ? "map_imported.pdl"
+                           : options.mode == Mode::ApplyDelta ? "map_patched.pdl"
+                           : "map_unpacked.txt";
+    if (options.ranged && options.mode != Mode::Extract)
+        throw std::runtime_error("--offset/--limit only apply to extraction");
+    if ((options.order != ObjectOrder::File || options.groupByType) &&
+        (options.ranged || options.mode != Mode::Extract))
+        throw std::runtime_error("--order and --group-by-type only apply to full extraction");
+    if (options.filter.active() && options.mode != Mode::Extract && options.mode != Mode::Stats)
+        throw std::runtime_error("--type/--box/--x/--y/--z only apply to extraction and --stats");
+    if (!(options.tolerance >= mapDiff::minTolerance))
+        throw std::runtime_error("--tolerance must be at least 1e-6");
+    if (options.saveLayout && options.layoutsFile.empty())
+        throw std::runtime_error("--save-layout requires --layouts <file>");
+
+    return options;
 }
 
-// --- Little Endian Readers ---
-uint32_t readLEUInt32(const uint8_t* data) {
-    return (uint32_t(data[3]) << 24) |
-           (uint32_t(data[2]) << 16) |
-           (uint32_t(data[1]) << 8)  |
-           (uint32_t(data[0]));
+// --- Record Ranges ---
+// Serves --offset/--limit through readRange, which decrypts only the AES blocks that
+// cover the requested records of the table at the header.
+int extractRange(const Options& options, const std::string& aesKey,
+                 const LayoutCatalog& knownLayouts, const TypeRegistry& types) {
+    const RecordRange range = readRange(options.inputFile, knownLayouts, options.offset, options.limit, aesKey);
+    if (range.match.known) {
+        std::cout << "[cpdl] Known layout for signature " << range.match.signature << ", skipping detection\n";
+    } else {
+        if (!range.match.found)
+            throw std::runtime_error("No record layout detected");
+
+        if (options.saveLayout) {
+            fileLoader::AppendText(options.layoutsFile, formatLayout(range.match.signature, range.match.layout));
+            std::cout << "[cpdl] Saved layout for signature " << range.match.signature << " to " << options.layoutsFile << "\n";
+        }
+    }
+
+    std::ofstream out(options.outputFile);
+    if (!out.is_open()) {
+        std::cerr << "[cpdl] Error: Failed to open output file.\n";
+        return 1;
+    }
+
+    out << "# type_id type_name x y z\n";
+    visitTable(range.records(), range.table, [&](const auto& view) {
+        if (options.filter.active())
+            writeObjects(out, view, types, options.filter);
+        else
+            writeObjects(out, view, types);
+    });
+
+    out.close();
+    const size_t valid = range.table.count;
+    if (valid == 0 && range.requested > 0)
+        std::cout << "[cpdl] No records at " << range.first << ", the table at the header ends at or before it";
+    else
+        std::cout << "[cpdl] Wrote records " << range.first << " to " << range.first + valid;
+    if (valid > 0 && valid < range.requested)
+        std::cout << ", where the table at the header ends";
+    std::cout << " (" << range.window.size() << " bytes decrypted) to: " << options.outputFile << "\n";
+    return 0;
 }
 
-float readLEFloat(const uint8_t* data) {
-    uint32_t temp = readLEUInt32(data);
-    float result;
-    std::memcpy(&result, &temp, sizeof(result));
-    return result;
+// --- Map Loading ---
+// Loads a whole map through the library, reports what was found and saves a newly
+// detected layout when asked to.
+Map loadMap(const std::string& filename, const Options& options, const std::string& aesKey,
+            const LayoutCatalog& knownLayouts, std::pmr::memory_resource* resource) {
+    Map map = load(filename, knownLayouts, aesKey, resource);
+
+    if (map.knownLayout) {
+        std::cout << "[cpdl] Known layout for signature " << map.signature << ", skipping detection\n";
+    } else if (options.saveLayout && !map.tables.empty()) {
+        fileLoader::AppendText(options.layoutsFile, formatLayout(map.signature, map.layout));
+        std::cout << "[cpdl] Saved layout for signature " << map.signature << " to " << options.layoutsFile << "\n";
+    }
+
+    std::cout << "[cpdl] Detected record size: " << map.layout.recordSize << " bytes\n";
+    std::cout << "[cpdl] Skipped header bytes: " << map.layout.headerSize << "\n";
+    std::cout << "[cpdl] Detected byte order: " << endianName(map.layout.endian) << "\n";
+    std::cout << "[cpdl] Parsed " << map.objectCount() << " objects in " << map.tables.size() << " table(s).\n";
+    return map;
 }
 
-// --- AES-128 ECB Decryption ---
-Buffer decryptAES128ECB(const Buffer& encrypted, const std::string& keyString) {
-    if (keyString.size() > 16)
-        throw std::runtime_error("AES key too long (must be 16 bytes for AES-128)");
+// --- Map Diff ---
+// Compares the older map (input) with the newer one (--diff) and writes the change
+// list with writeDiff.
+int diffMaps(const Options& options, const std::string& aesKey,
+             const LayoutCatalog& knownLayouts, const TypeRegistry& types,
+             std::pmr::memory_resource* resource) {
+    Map beforeMap = loadMap(options.inputFile, options, aesKey, knownLayouts, resource);
+    ObjectTable before = decodeTables(beforeMap.buffer, beforeMap.tables, resource);
+    beforeMap.buffer = Buffer();
+
+    Map afterMap = loadMap(options.newerFile, options, aesKey, knownLayouts, resource);
+    ObjectTable after = decodeTables(afterMap.buffer, afterMap.tables, resource);
+    afterMap.buffer = Buffer();
+
+    auto start = std::chrono::steady_clock::now();
+    const MapDiff diff = mapDiff::Compute(before, after, options.tolerance,
+                                          std::max(options.moveRadius, options.tolerance));
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+    std::ofstream out(options.outputFile);
+    if (!out.is_open()) {
+        std::cerr << "[cpdl] Error: Failed to open output file.\n";
+        return 1;
+    }
 
-    uint8_t key[16] = {0};
-    std::memcpy(key, keyString.c_str(), std::min<size_t>(16, keyString.size()));
+    writeDiff(out, diff, before, after, types);
 
-    Buffer decrypted;
-    decrypted.resize(encrypted.size());
+    out.close();
+    std::cout << "[cpdl] Diff (" << diff.moved.size() << " moved, " << diff.added.size() << " added, "
+              << diff.removed.size() << " removed) computed in " << elapsed.count() << " ms, written to: "
+              << options.outputFile << "\n";
+    return 0;
+}
 
-    AES_KEY aesKey;
-    if (AES_set_decrypt_key(key, 128, &aesKey) < 0) {
-        throw std::runtime_error("Failed to set AES decryption key");
-    }
+// --- Binary Deltas ---
+// Writes the delta from the input map to the newer one. Changes are cut on the record
+// grid of the input map's layout.
+int writeDelta(const Options& options, const std::string& aesKey,
+               const LayoutCatalog& knownLayouts,
+               std::pmr::memory_resource* resource) {
+    Map oldMap = loadMap(options.inputFile, options, aesKey, knownLayouts, resource);
+    Buffer newMap = fileLoader::Load(options.newerFile);
+    if (fileLoader::Size(options.inputFile) % aesBlockSize != 0 || newMap.size() % aesBlockSize != 0)
+        throw std::runtime_error("Map sizes must be whole AES blocks for a delta");
+
+    Buffer delta = makeDelta(oldMap.buffer, decryptAES128ECB(std::move(newMap), aesKey), oldMap.layout);
+    fileLoader::Save(options.outputFile, delta);
+    std::cout << "[cpdl] Delta of " << delta.size() << " bytes written to: " << options.outputFile << "\n";
+    return 0;
+}
 
-    for (size_t i = 0; i + 16 <= encrypted.size(); i += 16) {
-        AES_ecb_encrypt(encrypted.data() + i, decrypted.data() + i, &aesKey, AES_DECRYPT);
-    }
+// The delta is checked against the layout of the map it patches, read from the map's
+// first blocks.
+int patchMap(const Options& options, const std::string& aesKey, const LayoutCatalog& knownLayouts) {
+    const LayoutMatch match = matchFileLayout(options.inputFile, knownLayouts, aesKey);
+    if (!match.found)
+        throw std::runtime_error("No record layout detected");
+
+    Buffer map = fileLoader::Load(options.inputFile);
+    const size_t blocks = applyDelta(map, fileLoader::Load(options.deltaFile), match.layout, aesKey);
+    fileLoader::Save(options.outputFile, map);
+    std::cout << "[cpdl] Encrypted " << blocks << " blocks for a map of " << map.size() / aesBlockSize
+              << ", patched map written to: " << options.outputFile << "\n";
+    return 0;
+}
 
-    return decrypted;
+// --- Text Import ---
+// Reads extracted text (--import) and writes it back as an encrypted map in the layout
+// of the input map, which serves as the template.
+int importText(const Options& options, const std::string& aesKey,
+               const LayoutCatalog& knownLayouts,
+               std::pmr::memory_resource* resource) {
+    Map templateMap = loadMap(options.inputFile, options, aesKey, knownLayouts, resource);
+    if (templateMap.layout.recordSize == 0)
+        throw std::runtime_error("No record layout detected in the template map");
+
+    // Only the first table starts on the layout's record grid.
+    size_t templateRecords = 0;
+    if (!templateMap.tables.empty() && templateMap.tables[0].offset == templateMap.layout.headerSize &&
+        templateMap.tables[0].recordSize == templateMap.layout.recordSize)
+        templateRecords = templateMap.tables[0].count;
+
+    const Buffer text = fileLoader::Load(options.importFile);
+    auto start = std::chrono::steady_clock::now();
+    ObjectTable objects = objectText::Parse(reinterpret_cast<const char*>(text.data()), text.size(), 0, resource);
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+    Buffer map = encryptAES128ECB(encodeMap(templateMap.buffer, templateMap.layout, templateRecords, objects), aesKey);
+    fileLoader::Save(options.outputFile, map);
+
+    std::cout << "[cpdl] Parsed " << objects.size() << " objects from " << options.importFile << " at "
+              << (elapsed.count() > 0 ? text.size() / elapsed.count() / 1e6 : 0.0) << " MB/s\n";
+    std::cout << "[cpdl] Map written to: " << options.outputFile << "\n";
+    return 0;
 }
 
-// --- Record Size Guesser (Little Endian only) ---
-std::vector<PDLObject> tryRecordSize(const Buffer& buffer, size_t recordSize, size_t& headerSizeOut) {
-    std::vector<PDLObject> result;
-    size_t bestHeader = 0;
+int main(int argc, char** argv) {
+    try {
+        if (argc > 1 && (std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h")) {
+            printUsage();
+            return 0;
+        }
 
-    for (size_t headerOffset = 0; headerOffset < 64; headerOffset += 4) {
-        std::vector<PDLObject> objects;
-        size_t offset = headerOffset;
+        Options options = parseOptions(argc, argv);
+        const std::string aesKey = defaultKey;
 
-        while (offset + recordSize <= buffer.size()) {
-            const uint8_t* base = buffer.data() + offset;
+        LayoutCatalog knownLayouts;
+        if (!options.layoutsFile.empty())
+            knownLayouts = loadLayouts(options.layoutsFile);
 
-            PDLObject obj;
-            obj.type = readLEUInt32(base + 0);
-            obj.x    = readLEFloat(base + 4);
-            obj.y    = readLEFloat(base + 8);
-            obj.z    = readLEFloat(base + 12);
-            obj.offset = offset;
+        TypeRegistry types;
+        if (!options.typesFile.empty())
+            types.load(options.typesFile);
 
-            if (isReasonableCoord(obj.x) && isReasonableCoord(obj.y) && isReasonableCoord(obj.z)) {
-                objects.push_back(obj);
-            } else {
-                break;
+        if (options.ranged)
+            return extractRange(options, aesKey, knownLayouts, types);
+
+        // Parse state for this map is released in one shot when the arena goes away.
+        std::pmr::monotonic_buffer_resource arena;
+
+        if (options.mode == Mode::Diff)
+            return diffMaps(options, aesKey, knownLayouts, types, &arena);
+        if (options.mode == Mode::MakeDelta)
+            return writeDelta(options, aesKey, knownLayouts, &arena);
+        if (options.mode == Mode::ApplyDelta)
+            return patchMap(options, aesKey, knownLayouts);
+        if (options.mode == Mode::Import)
+            return importText(options, aesKey, knownLayouts, &arena);
+
+        Map map = loadMap(options.inputFile, options, aesKey, knownLayouts, &arena);
+        const Buffer& buffer = map.buffer;
+        std::pmr::vector<RecordTable>& tables = map.tables;
+
+        size_t objectCount = 0;
+        for (const auto& table : tables)
+            objectCount += table.count;
+
+        std::ofstream out(options.outputFile);
+        if (!out.is_open()) {
+            std::cerr << "[cpdl] Error: Failed to open output file.\n";
+            return 1;
+        }
+
+        if (options.mode == Mode::Stats) {
+            // Distinct types are bounded by the record count; the cap keeps huge maps
+            // from reserving far more slots than there are types.
+            FlatHashMap<TypeStats> stats(std::min<size_t>(objectCount, 1 << 16));
+            for (const auto& table : tables) {
+                visitTable(buffer, table, [&](const auto& view) {
+                    if (options.filter.active())
+                        accumulateTypeStats(view, stats, options.filter);
+                    else
+                        accumulateTypeStats(view, stats);
+                });
             }
 
-            offset += recordSize;
+            size_t selectedCount = 0;
+            stats.forEach([&](uint32_t, const TypeStats& entry) { selectedCount += entry.count; });
+
+            writeTypeStats(out, stats, types, selectedCount);
+            out.close();
+            std::cout << "[cpdl] Type statistics written to: " << options.outputFile << "\n";
+            return 0;
         }
 
-        if (objects.size() > result.size()) {
-            result = objects;
-            bestHeader = headerOffset;
+        if (options.mode == Mode::Summary) {
+            ObjectTable objects = decodeTables(buffer, tables, &arena);
+            writeCoordSummary(out, objects, types);
+            out.close();
+            std::cout << "[cpdl] Coordinate summary written to: " << options.outputFile << "\n";
+            return 0;
         }
-    }
 
-    headerSizeOut = bestHeader;
-    return result;
-}
+        if (options.mode == Mode::Quantize) {
+            ObjectTable objects = decodeTables(buffer, tables, &arena);
+            const QuantizedTable quantized(objects, options.quantizeBits);
+
+            // Time a full dequantization pass on its own, as a query scan would run it.
+            std::vector<float> xs(objects.size()), ys(objects.size()), zs(objects.size());
+            auto start = std::chrono::steady_clock::now();
+            quantized.dequantize(0, quantized.size(), xs.data(), ys.data(), zs.data());
+            auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+            writeQuantizationReport(out, objects, quantized, elapsed.count());
+            out.close();
+            std::cout << "[cpdl] " << quantized.bits() << "-bit coordinates take " << quantized.memoryBytes()
+                      << " bytes, report written to: " << options.outputFile << "\n";
+            return 0;
+        }
 
-int main() {
-    try {
-        std::string inputFile = "map.pdl";
-        std::string outputFile = "map_unpacked.txt";
-        std::string aesKey = "Planet Droidia";  // 15 bytes, will be padded
+        if (options.mode == Mode::Duplicates) {
+            ObjectTable objects = decodeTables(buffer, tables, &arena);
+            auto start = std::chrono::steady_clock::now();
+            const Duplicates found = duplicates::Find(objects, buffer, options.tolerance);
+            auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+            writeDuplicates(out, objects, found, options.tolerance, types);
+            out.close();
+            std::cout << "[cpdl] Found " << found.exact.size() << " exact and " << found.near.size()
+                      << " near duplicates in " << elapsed.count() << " ms, written to: " << options.outputFile << "\n";
+            return 0;
+        }
+
+        if (options.mode == Mode::Query) {
+            std::ifstream queries(options.queriesFile);
+            if (!queries)
+                throw std::runtime_error("Failed to open queries file " + options.queriesFile);
 
-        // Load and decrypt
-        Buffer encryptedBuffer = fileLoader::Load(inputFile);
-        
+            ObjectTable objects = decodeTables(buffer, tables, &arena);
+            auto start = std::chrono::steady_clock::now();
+            size_t count = runQueries(queries, out, objects, types);
+            auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
 
-        Buffer buffer = decryptAES128ECB(encryptedBuffer, aesKey);
+            out.close();
+            std::cout << "[cpdl] Answered " << count << " queries in " << elapsed.count() << " ms, written to: "
+                      << options.outputFile << "\n";
+            return 0;
+        }
 
-        const std::vector<size_t> candidateRecordSizes = {16, 20, 24, 32};
-        std::vector<PDLObject> bestObjects;
-        size_t bestSize = 0;
-        size_t bestHeader = 0;
+        out << "# type_id type_name x y z\n";
 
-        for (auto size : candidateRecordSizes) {
-            size_t headerLE;
-            auto objsLE = tryRecordSize(buffer, size, headerLE);
+        if (options.order != ObjectOrder::File || options.groupByType) {
+            // Reordered output mixes tables, so there are no per-table headers.
+            ObjectTable objects = decodeTables(buffer, tables, &arena);
 
-            if (objsLE.size() > bestObjects.size()) {
-                bestObjects = objsLE;
-                bestSize = size;
-                bestHeader = headerLE;
+            std::vector<uint32_t> order;
+            if (options.order == ObjectOrder::Morton) {
+                order = morton::Order(objects);
+            } else {
+                order.resize(objects.size());
+                for (size_t i = 0; i < order.size(); ++i)
+                    order[i] = uint32_t(i);
             }
-        }
 
-        std::cout << "[cpdl] Detected record size: " << bestSize << " bytes\n";
-        std::cout << "[cpdl] Skipped header bytes: " << bestHeader << "\n";
-        std::cout << "[cpdl] Parsed " << bestObjects.size() << " objects (Little Endian only).\n";
+            if (options.filter.active())
+                filterOrder(objects, options.filter, order);
 
-        std::ofstream out(outputFile);
-        if (!out.is_open()) {
-            std::cerr << "[cpdl] Error: Failed to open output file.\n";
-            return 1;
+            if (options.groupByType)
+                writeGroupedObjects(out, objects, groupByType(objects, std::move(order)), types);
+            else
+                writeObjects(out, objects, order, types);
+
+            out.close();
+            std::cout << "[cpdl] Unpacked file (reordered) written to: " << options.outputFile << "\n";
+            return 0;
         }
 
-        out << "# type_id type_name x y z\n";
-        for (const auto& o : bestObjects) {
-            out << o.type << " " << getTypeName(o.type) << " "
-                << std::fixed << std::setprecision(6)
-                << o.x << " " << o.y << " " << o.z << "\n";
+        for (const auto& table : tables) {
+            if (tables.size() > 1) {
+                out << "# table offset " << table.offset << " record_size " << table.recordSize
+                    << " count " << table.count
+                    << (table.endian == Endian::Big ? " big_endian" : " little_endian") << "\n";
+            }
+
+            visitTable(buffer, table, [&](const auto& view) {
+                if (options.filter.active())
+                    writeObjects(out, view, types, options.filter);
+                else
+                    writeObjects(out, view, types);
+            });
         }
 
         out.close();
-        std::cout << "[cpdl] Unpacked file written to: " << outputFile << "\n";
+        std::cout << "[cpdl] Unpacked file written to: " << options.outputFile << "\n";
 
     } catch (const std::exception& e) {
         std::cerr << "[cpdl] Error: " << e.what() << "\n";
@@ -0,0 +1,72 @@
+#pragma once
+#include "../stuff/Buffer.h"
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <openssl/aes.h>
+#include <openssl/evp.h>
+
+namespace cpdl {
+
+    // --- AES-128 ECB ---
+    inline constexpr size_t aesBlockSize = 16;
+
+    // The key every map shipped with the game is encrypted with.
+    inline const std::string defaultKey = "Planet Droidia"; // 15 bytes, will be padded
+
+    // The key string zero-padded to the 16 bytes of an AES-128 key.
+    inline void aesKeyBytes(const std::string& keyString, uint8_t (&key)[16]) {
+        if (keyString.size() > 16)
+            throw std::runtime_error("AES key too long (must be 16 bytes for AES-128)");
+
+        std::memset(key, 0, 16);
+        std::memcpy(key, keyString.c_str(), keyString.size());
+    }
+
+    // Decrypts in place, so a map needs one buffer rather than an encrypted and a decrypted
+    // copy. Pass an rvalue to hand over the encrypted buffer without copying it.
+    inline Buffer decryptAES128ECB(Buffer buffer, const std::string& keyString) {
+        uint8_t key[16];
+        aesKeyBytes(keyString, key);
+
+        AES_KEY aesKey;
+        if (AES_set_decrypt_key(key, 128, &aesKey) < 0) {
+            throw std::runtime_error("Failed to set AES decryption key");
+        }
+
+        size_t i = 0;
+        for (; i + 16 <= buffer.size(); i += 16) {
+            AES_ecb_encrypt(buffer.data() + i, buffer.data() + i, &aesKey, AES_DECRYPT);
+        }
+
+        // A trailing partial block cannot be decrypted.
+        std::fill(buffer.begin() + i, buffer.end(), 0);
+
+        return buffer;
+    }
+
+    // Encrypts in place with the same key handling as decryptAES128ECB. Maps are whole
+    // blocks, so a partial block is an error rather than padded.
+    inline Buffer encryptAES128ECB(Buffer buffer, const std::string& keyString) {
+        if (buffer.size() % 16 != 0)
+            throw std::runtime_error("Cannot encrypt a partial AES block");
+
+        uint8_t key[16];
+        aesKeyBytes(keyString, key);
+
+        AES_KEY aesKey;
+        if (AES_set_encrypt_key(key, 128, &aesKey) < 0) {
+            throw std::runtime_error("Failed to set AES encryption key");
+        }
+
+        for (size_t i = 0; i < buffer.size(); i += 16) {
+            AES_ecb_encrypt(buffer.data() + i, buffer.data() + i, &aesKey, AES_ENCRYPT);
+        }
+
+        return buffer;
+    }
+
+}
@@ -0,0 +1,241 @@
+#pragma once
+#include "Records.h"
+#include "../stuff/Buffer.h"
+#include "../stuff/ObjectTable.h"
+#include "../stuff/ObjectFilter.h"
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <memory_resource>
+
+namespace cpdl {
+
+    // --- Record Decoders ---
+    // Decodes a run of records that the scanner already validated straight into the
+    // ObjectTable columns. The stride is a compile-time constant, so the loop has fixed
+    // addressing and no bounds or validity branches, which lets the compiler unroll and
+    // vectorize it.
+    template <size_t Stride, Endian E = Endian::Little>
+    struct RecordDecoder {
+        static_assert(Stride >= 16, "a record holds a type ID and three floats");
+
+        static void decode(const uint8_t* base, size_t count, ObjectTable& out, size_t first) {
+            uint32_t* types = out.types() + first;
+            float* xs = out.xs() + first;
+            float* ys = out.ys() + first;
+            float* zs = out.zs() + first;
+
+            for (size_t i = 0; i < count; ++i) {
+                const uint8_t* record = base + i * Stride;
+                types[i] = readUInt32<E>(record + 0);
+                xs[i] = readFloat<E>(record + 4);
+                ys[i] = readFloat<E>(record + 8);
+                zs[i] = readFloat<E>(record + 12);
+            }
+        }
+    };
+
+    // Fallback for strides found by discovery that have no specialized decoder, and for
+    // layout descriptors with non-default field offsets.
+    template <Endian E>
+    void decodeRecords(const uint8_t* base, size_t recordSize, const FieldOffsets& fields,
+                       size_t count, ObjectTable& out, size_t first) {
+        for (size_t i = 0; i < count; ++i)
+            out.set(first + i, readRecord<E>(base + i * recordSize, fields));
+    }
+
+    template <Endian E>
+    void decodeTableAs(const Buffer& buffer, const RecordTable& table, ObjectTable& out) {
+        const uint8_t* base = buffer.data() + table.offset;
+        const size_t first = table.firstObject;
+
+        if (!(table.fields == FieldOffsets())) {
+            decodeRecords<E>(base, table.recordSize, table.fields, table.count, out, first);
+            return;
+        }
+
+        switch (table.recordSize) {
+            case 16: RecordDecoder<16, E>::decode(base, table.count, out, first); break;
+            case 20: RecordDecoder<20, E>::decode(base, table.count, out, first); break;
+            case 24: RecordDecoder<24, E>::decode(base, table.count, out, first); break;
+            case 32: RecordDecoder<32, E>::decode(base, table.count, out, first); break;
+            default: decodeRecords<E>(base, table.recordSize, table.fields, table.count, out, first); break;
+        }
+    }
+
+    // Decodes every table into one ObjectTable, in file order.
+    inline ObjectTable decodeTables(const Buffer& buffer, std::pmr::vector<RecordTable>& tables,
+                                    std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+        size_t total = 0;
+        for (auto& table : tables) {
+            table.firstObject = total;
+            total += table.count;
+        }
+
+        ObjectTable objects(resource);
+        objects.resize(total);
+
+        for (const auto& table : tables) {
+            objects.addSegment(table.firstObject, table.offset, table.recordSize);
+
+            if (table.endian == Endian::Big)
+                decodeTableAs<Endian::Big>(buffer, table, objects);
+            else
+                decodeTableAs<Endian::Little>(buffer, table, objects);
+        }
+
+        return objects;
+    }
+
+    // --- Record Views ---
+    // A table's records read in place from the decrypted buffer, decoding fields on access.
+    // With a non-zero Stride the record size and field offsets are compile-time constants;
+    // RecordView<0, E> takes both at runtime for the other layouts.
+    template <size_t Stride, Endian E>
+    class RecordView {
+    public:
+        class iterator {
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type = PDLObject;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const PDLObject*;
+            using reference = PDLObject;
+
+            iterator(const RecordView* view, size_t index) : view(view), index(index) {}
+
+            PDLObject operator*() const { return (*view)[index]; }
+            iterator& operator++() { ++index; return *this; }
+            iterator operator++(int) { iterator it = *this; ++index; return it; }
+            bool operator==(const iterator& other) const { return index == other.index; }
+            bool operator!=(const iterator& other) const { return index != other.index; }
+
+        private:
+            const RecordView* view;
+            size_t index;
+        };
+
+        RecordView(const uint8_t* base, size_t offset, size_t count,
+                   size_t recordSize = Stride, const FieldOffsets& fields = FieldOffsets())
+            : base(base), offset(offset), count(count), recordSize(recordSize), fields(fields) {}
+
+        size_t size() const { return count; }
+        size_t stride() const { return Stride ? Stride : recordSize; }
+
+        // Byte offset of a record in the map, derived rather than stored per object.
+        size_t offsetOf(size_t index) const { return offset + index * stride(); }
+
+        PDLObject operator[](size_t index) const {
+            const size_t at = index * stride();
+            return Stride ? readRecord<E>(base + at) : readRecord<E>(base + at, fields);
+        }
+
+        iterator begin() const { return iterator(this, 0); }
+        iterator end() const { return iterator(this, count); }
+
+    private:
+        const uint8_t* base;
+        size_t offset;
+        size_t count;
+        size_t recordSize;
+        FieldOffsets fields;
+    };
+
+    template <Endian E, typename Fn>
+    void visitTableAs(const uint8_t* base, const RecordTable& table, Fn& fn) {
+        if (!(table.fields == FieldOffsets())) {
+            fn(RecordView<0, E>(base, table.offset, table.count, table.recordSize, table.fields));
+            return;
+        }
+
+        switch (table.recordSize) {
+            case 16: fn(RecordView<16, E>(base, table.offset, table.count)); break;
+            case 20: fn(RecordView<20, E>(base, table.offset, table.count)); break;
+            case 24: fn(RecordView<24, E>(base, table.offset, table.count)); break;
+            case 32: fn(RecordView<32, E>(base, table.offset, table.count)); break;
+            default: fn(RecordView<0, E>(base, table.offset, table.count, table.recordSize)); break;
+        }
+    }
+
+    // Calls fn once with the RecordView that matches the table's layout, so streaming
+    // consumers are instantiated per layout and never materialize the objects. base points
+    // at the table's first record, which need not be inside a whole-map buffer.
+    template <typename Fn>
+    void visitTable(const uint8_t* base, const RecordTable& table, Fn&& fn) {
+        if (table.endian == Endian::Big)
+            visitTableAs<Endian::Big>(base, table, fn);
+        else
+            visitTableAs<Endian::Little>(base, table, fn);
+    }
+
+    template <typename Fn>
+    void visitTable(const Buffer& buffer, const RecordTable& table, Fn&& fn) {
+        visitTable(buffer.data() + table.offset, table, std::forward<Fn>(fn));
+    }
+
+    // Record i of a layout lives at headerSize + i * recordSize.
+    inline size_t recordOffset(const RecordLayout& layout, size_t index) {
+        return layout.headerSize + index * layout.recordSize;
+    }
+
+    inline PDLObject recordAt(const Buffer& buffer, const RecordLayout& layout, size_t index) {
+        const size_t offset = recordOffset(layout, index);
+        if (offset + layout.recordSize > buffer.size())
+            throw std::out_of_range("Record index out of range");
+
+        const uint8_t* base = buffer.data() + offset;
+        return layout.endian == Endian::Big
+            ? readRecord<Endian::Big>(base, layout.fields)
+            : readRecord<Endian::Little>(base, layout.fields);
+    }
+
+    // --- Filters ---
+    // Decodes a view one block at a time into column buffers on the stack, runs the filter
+    // over the whole block and calls fn(index, object) only for the selected records, so a
+    // selective filter costs one pass over the records and formats nothing it drops.
+    template <typename View, typename Fn>
+    void forEachSelected(const View& view, const ObjectFilter& filter, Fn&& fn) {
+        constexpr size_t block = ObjectFilter::blockSize;
+        uint32_t types[block];
+        float xs[block], ys[block], zs[block];
+        uint8_t keep[block];
+
+        for (size_t begin = 0; begin < view.size(); begin += block) {
+            const size_t n = std::min(block, view.size() - begin);
+            for (size_t i = 0; i < n; ++i) {
+                const PDLObject o = view[begin + i];
+                types[i] = o.type;
+                xs[i] = o.x;
+                ys[i] = o.y;
+                zs[i] = o.z;
+            }
+
+            if (filter.select(types, xs, ys, zs, n, keep) == 0)
+                continue;
+
+            for (size_t i = 0; i < n; ++i) {
+                if (keep[i])
+                    fn(begin + i, PDLObject{types[i], xs[i], ys[i], zs[i]});
+            }
+        }
+    }
+
+    // Drops the objects the filter rejects from an index order, keeping the rest in order.
+    // The filter runs over the ObjectTable columns directly.
+    inline void filterOrder(const ObjectTable& objects, const ObjectFilter& filter, std::vector<uint32_t>& order) {
+        std::vector<uint8_t> keep(objects.size());
+        for (size_t begin = 0; begin < objects.size(); begin += ObjectFilter::blockSize) {
+            const size_t n = std::min(ObjectFilter::blockSize, objects.size() - begin);
+            filter.select(objects.types() + begin, objects.xs() + begin, objects.ys() + begin, objects.zs() + begin,
+                          n, keep.data() + begin);
+        }
+
+        order.erase(std::remove_if(order.begin(), order.end(), [&](uint32_t index) { return !keep[index]; }),
+                    order.end());
+    }
+
+}
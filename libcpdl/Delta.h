@@ -0,0 +1,344 @@
+#pragma once
+#include "Crypto.h"
+#include "Records.h"
+#include "../stuff/Buffer.h"
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+
+namespace cpdl {
+
+    // --- Binary Deltas ---
+    // A delta rewrites an older map into a newer one as a list of operations. All integers
+    // are little-endian, so a delta applies on any host:
+    //   "CPDLDLT2" | u32 recordSize | u32 headerSize | u64 oldSize | u64 newSize | u64 opCount
+    //   opCount x (u8 op | u64 offset | u64 length | u32 checksum | payload)
+    // Replace overwrites length bytes at offset with the payload, Insert puts the payload
+    // in front of offset and Delete removes length bytes from offset; only Replace and
+    // Insert carry a payload. Offsets are in the map as the earlier operations left it, and
+    // operations come in ascending order without overlapping. The checksum is of the bytes
+    // a Replace or Delete takes out, 0 for Insert. The layout, the old size and those
+    // checksums make a delta refuse to apply to the wrong map.
+    inline constexpr char deltaMagic[8] = {'C', 'P', 'D', 'L', 'D', 'L', 'T', '2'};
+
+    enum class DeltaOp : uint8_t { Replace = 0, Insert = 1, Delete = 2 };
+
+    inline uint32_t deltaChecksum(const uint8_t* data, size_t size) {
+        uint32_t hash = 2166136261u; // FNV-1a
+        for (size_t i = 0; i < size; ++i)
+            hash = (hash ^ data[i]) * 16777619u;
+        return hash;
+    }
+
+    inline void writeDeltaInt(Buffer& out, uint64_t value, size_t bytes) {
+        for (size_t i = 0; i < bytes; ++i)
+            out.push_back(uint8_t(value >> (8 * i)));
+    }
+
+    inline uint64_t readDeltaInt(const Buffer& in, size_t& at, size_t bytes) {
+        if (at > in.size() || bytes > in.size() - at)
+            throw std::runtime_error("Truncated delta");
+
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; ++i)
+            value |= uint64_t(in[at + i]) << (8 * i);
+        at += bytes;
+        return value;
+    }
+
+    // Matches the maps from both ends first: a common prefix on the record grid of the
+    // older map's layout, and a common suffix counted back from the last non-zero byte of
+    // each, so AES padding of a different length does not hide it. The middle is walked a
+    // record at a time on both maps. Where records differ, the next maxShift records of
+    // either map are searched for a point where confirmRun records line up again, which
+    // becomes an Insert or a Delete; otherwise the record joins a Replace run. A record
+    // inserted or deleted mid-map therefore costs one record in the delta, and where the
+    // header and stride are whole AES blocks the later ciphertext moves as it is.
+    inline Buffer makeDelta(const Buffer& oldMap, const Buffer& newMap, const RecordLayout& layout) {
+        if (layout.recordSize == 0)
+            throw std::runtime_error("No record layout detected");
+
+        const size_t common = std::min(oldMap.size(), newMap.size());
+        const size_t recordSize = layout.recordSize;
+        const size_t headerSize = std::min(layout.headerSize, common);
+
+        // Slot boundaries on the older map: the header, then one slot per record.
+        auto slotEnd = [&](size_t begin, size_t end) {
+            return begin < headerSize ? std::min(end, headerSize) : std::min(end, begin + recordSize);
+        };
+        auto same = [&](size_t oldAt, size_t newAt, size_t size) {
+            return std::memcmp(oldMap.data() + oldAt, newMap.data() + newAt, size) == 0;
+        };
+
+        size_t prefix = 0;
+        while (prefix < common && same(prefix, prefix, slotEnd(prefix, common) - prefix))
+            prefix = slotEnd(prefix, common);
+
+        auto contentEnd = [&](const Buffer& map) {
+            size_t end = map.size();
+            while (end > prefix && map.size() - end < aesBlockSize - 1 && map[end - 1] == 0)
+                --end;
+            return end;
+        };
+        const size_t oldEnd = contentEnd(oldMap), newEnd = contentEnd(newMap);
+        size_t suffix = 0;
+        while (suffix < oldEnd - prefix && suffix < newEnd - prefix &&
+               oldMap[oldEnd - 1 - suffix] == newMap[newEnd - 1 - suffix])
+            ++suffix;
+
+        Buffer ops;
+        uint64_t opCount = 0;
+        auto emit = [&](DeltaOp op, size_t offset, size_t length, uint32_t checksum, const uint8_t* payload) {
+            ops.push_back(uint8_t(op));
+            writeDeltaInt(ops, offset, 8);
+            writeDeltaInt(ops, length, 8);
+            writeDeltaInt(ops, checksum, 4);
+            if (payload)
+                ops.write_from(payload, length);
+            ++opCount;
+        };
+
+        // Turns old bytes from oldBegin into new ones from newBegin. Everything before
+        // newBegin is already new, so offsets in the patched map are new-map offsets.
+        auto emitRegion = [&](size_t oldBegin, size_t oldSize, size_t newBegin, size_t newSize) {
+            const size_t overlap = std::min(oldSize, newSize);
+            for (size_t k = 0; k < overlap;) {
+                size_t end = slotEnd(oldBegin + k, oldBegin + overlap) - oldBegin;
+                if (same(oldBegin + k, newBegin + k, end - k)) {
+                    k = end;
+                    continue;
+                }
+
+                // Merge runs of changed slots into one range.
+                while (end < overlap) {
+                    const size_t next = slotEnd(oldBegin + end, oldBegin + overlap) - oldBegin;
+                    if (same(oldBegin + end, newBegin + end, next - end))
+                        break;
+                    end = next;
+                }
+
+                emit(DeltaOp::Replace, newBegin + k, end - k, deltaChecksum(oldMap.data() + oldBegin + k, end - k),
+                     newMap.data() + newBegin + k);
+                k = end;
+            }
+
+            if (newSize > overlap)
+                emit(DeltaOp::Insert, newBegin + overlap, newSize - overlap, 0, newMap.data() + newBegin + overlap);
+            if (oldSize > overlap)
+                emit(DeltaOp::Delete, newBegin + overlap, oldSize - overlap,
+                     deltaChecksum(oldMap.data() + oldBegin + overlap, oldSize - overlap), nullptr);
+        };
+
+        const size_t oldStop = oldEnd - suffix, newStop = newEnd - suffix;
+        size_t i = prefix, j = prefix;
+        if (i < headerSize) {
+            const size_t header = std::min({headerSize, oldStop, newStop});
+            emitRegion(i, header - i, j, header - j);
+            i = j = header;
+        }
+
+        const size_t maxShift = 16, confirmRun = 4;
+        auto linedUp = [&](size_t oldAt, size_t newAt) {
+            for (size_t r = 0; r < confirmRun; ++r, oldAt += recordSize, newAt += recordSize) {
+                if (oldAt + recordSize > oldStop || newAt + recordSize > newStop)
+                    return r > 0;
+                if (!same(oldAt, newAt, recordSize))
+                    return false;
+            }
+            return true;
+        };
+
+        size_t runOld = i, runNew = j;
+        auto flushRun = [&]() {
+            if (i > runOld)
+                emit(DeltaOp::Replace, runNew, i - runOld, deltaChecksum(oldMap.data() + runOld, i - runOld),
+                     newMap.data() + runNew);
+        };
+
+        while (i + recordSize <= oldStop && j + recordSize <= newStop) {
+            size_t inserted = 0, deleted = 0;
+            if (!same(i, j, recordSize)) {
+                for (size_t d = 1; d <= maxShift && !inserted && !deleted; ++d) {
+                    if (linedUp(i, j + d * recordSize))
+                        inserted = d * recordSize;
+                    else if (linedUp(i + d * recordSize, j))
+                        deleted = d * recordSize;
+                }
+                if (!inserted && !deleted) {
+                    i += recordSize;
+                    j += recordSize;
+                    continue;
+                }
+            }
+
+            flushRun();
+            if (inserted)
+                emit(DeltaOp::Insert, j, inserted, 0, newMap.data() + j);
+            if (deleted)
+                emit(DeltaOp::Delete, j, deleted, deltaChecksum(oldMap.data() + i, deleted), nullptr);
+            i += deleted;
+            j += inserted;
+            if (!inserted && !deleted) {
+                i += recordSize;
+                j += recordSize;
+            }
+            runOld = i;
+            runNew = j;
+        }
+        flushRun();
+
+        emitRegion(i, oldStop - i, j, newStop - j);
+        emitRegion(oldEnd, oldMap.size() - oldEnd, newEnd, newMap.size() - newEnd);
+
+        Buffer delta;
+        delta.write_from(deltaMagic, sizeof(deltaMagic));
+        writeDeltaInt(delta, recordSize, 4);
+        writeDeltaInt(delta, layout.headerSize, 4);
+        writeDeltaInt(delta, oldMap.size(), 8);
+        writeDeltaInt(delta, newMap.size(), 8);
+        writeDeltaInt(delta, opCount, 8);
+        delta.write_from(ops.data(), ops.size());
+        return delta;
+    }
+
+    // Applies a delta to an encrypted map whose layout is given. A Replace decrypts,
+    // patches and encrypts only the AES blocks it touches. An Insert or Delete of whole
+    // blocks at a block boundary moves the ciphertext after it unchanged; any other one
+    // leaves the map decrypted from its block on, which is encrypted again at the end.
+    // The whole delta is checked against the map before any byte of the map changes.
+    // Returns the number of block encryptions done, inserted blocks included; a block
+    // patched by a Replace and later decrypted again for a shift counts twice.
+    inline size_t applyDelta(Buffer& map, const Buffer& delta, const RecordLayout& layout, const std::string& aesKey) {
+        if (delta.size() < sizeof(deltaMagic) || std::memcmp(delta.data(), deltaMagic, sizeof(deltaMagic)) != 0)
+            throw std::runtime_error("Not a cpdl delta");
+
+        size_t at = sizeof(deltaMagic);
+        const uint64_t recordSize = readDeltaInt(delta, at, 4);
+        const uint64_t headerSize = readDeltaInt(delta, at, 4);
+        const uint64_t oldSize = readDeltaInt(delta, at, 8);
+        const uint64_t newSize = readDeltaInt(delta, at, 8);
+        const uint64_t opCount = readDeltaInt(delta, at, 8);
+
+        if (recordSize != layout.recordSize || headerSize != layout.headerSize)
+            throw std::runtime_error("Delta was made for " + std::to_string(recordSize) + "-byte records after a " +
+                                     std::to_string(headerSize) + "-byte header");
+        if (map.size() != oldSize)
+            throw std::runtime_error("Delta was made for a map of " + std::to_string(oldSize) + " bytes");
+        if (oldSize % aesBlockSize != 0 || newSize % aesBlockSize != 0)
+            throw std::runtime_error("Delta map sizes are not whole AES blocks");
+
+        struct Operation {
+            DeltaOp op;
+            size_t offset;
+            size_t length;
+            size_t payload; // position of the new bytes in the delta
+        };
+
+        auto blockAligned = [](size_t value) { return value % aesBlockSize == 0; };
+        auto crypt = [&](size_t begin, size_t end, bool encrypt) {
+            Buffer part(std::vector<uint8_t>(map.begin() + begin, map.begin() + end));
+            part = encrypt ? encryptAES128ECB(std::move(part), aesKey) : decryptAES128ECB(std::move(part), aesKey);
+            std::copy(part.begin(), part.end(), map.begin() + begin);
+        };
+
+        // Checks every operation against the untouched map. Each operand is compared on its
+        // own, so a crafted length cannot wrap a sum past the bounds. Removed bytes are
+        // found in the original map by undoing the size changes before them.
+        std::vector<Operation> operations;
+        size_t size = oldSize, end = 0, inserted = 0, deleted = 0;
+        for (uint64_t i = 0; i < opCount; ++i) {
+            const uint64_t op = readDeltaInt(delta, at, 1);
+            Operation operation{DeltaOp(op), size_t(readDeltaInt(delta, at, 8)), size_t(readDeltaInt(delta, at, 8)), 0};
+            const uint32_t checksum = uint32_t(readDeltaInt(delta, at, 4));
+            const size_t offset = operation.offset, length = operation.length;
+
+            if (op > uint64_t(DeltaOp::Delete) || offset < end || offset > size)
+                throw std::runtime_error("Malformed delta operation");
+            if (operation.op != DeltaOp::Insert && length > size - offset)
+                throw std::runtime_error("Malformed delta operation");
+            if (operation.op != DeltaOp::Delete) {
+                if (length > delta.size() - at)
+                    throw std::runtime_error("Malformed delta operation");
+                operation.payload = at;
+                at += length;
+            }
+
+            if (operation.op != DeltaOp::Insert) {
+                const size_t original = offset - inserted + deleted;
+                const size_t windowBegin = original / aesBlockSize * aesBlockSize;
+                const size_t windowEnd = (original + length + aesBlockSize - 1) / aesBlockSize * aesBlockSize;
+                const Buffer window = decryptAES128ECB(
+                    Buffer(std::vector<uint8_t>(map.begin() + windowBegin, map.begin() + windowEnd)), aesKey);
+                if (deltaChecksum(window.data() + (original - windowBegin), length) != checksum)
+                    throw std::runtime_error("Delta does not match the input map at offset " + std::to_string(offset));
+            }
+
+            if (operation.op == DeltaOp::Insert) {
+                size += length;
+                inserted += length;
+            } else if (operation.op == DeltaOp::Delete) {
+                size -= length;
+                deleted += length;
+            }
+            end = operation.op == DeltaOp::Delete ? offset : offset + length;
+            operations.push_back(operation);
+        }
+
+        if (size != newSize || at != delta.size())
+            throw std::runtime_error("Malformed delta");
+
+        // Bytes from plainFrom on are decrypted; plainFrom stays on a block boundary.
+        size_t plainFrom = map.size();
+        auto decryptFrom = [&](size_t offset) {
+            const size_t begin = offset / aesBlockSize * aesBlockSize;
+            if (begin < plainFrom) {
+                crypt(begin, plainFrom, false);
+                plainFrom = begin;
+            }
+        };
+
+        size_t blocks = 0;
+        for (const Operation& operation : operations) {
+            const size_t offset = operation.offset, length = operation.length;
+            const uint8_t* payload = delta.data() + operation.payload;
+            const bool wholeBlocks = blockAligned(offset) && blockAligned(length) && offset <= plainFrom;
+
+            if (operation.op == DeltaOp::Replace && offset + length <= plainFrom) {
+                const size_t windowBegin = offset / aesBlockSize * aesBlockSize;
+                const size_t windowEnd = (offset + length + aesBlockSize - 1) / aesBlockSize * aesBlockSize;
+                crypt(windowBegin, windowEnd, false);
+                std::memcpy(map.data() + offset, payload, length);
+                crypt(windowBegin, windowEnd, true);
+                blocks += (windowEnd - windowBegin) / aesBlockSize;
+            } else if (operation.op == DeltaOp::Replace) {
+                decryptFrom(offset);
+                std::memcpy(map.data() + offset, payload, length);
+            } else if (operation.op == DeltaOp::Insert && wholeBlocks) {
+                Buffer encrypted = encryptAES128ECB(Buffer(std::vector<uint8_t>(payload, payload + length)), aesKey);
+                map.insert(map.begin() + offset, encrypted.begin(), encrypted.end());
+                plainFrom += length;
+                blocks += length / aesBlockSize;
+            } else if (operation.op == DeltaOp::Insert) {
+                decryptFrom(offset);
+                map.insert(map.begin() + offset, payload, payload + length);
+            } else if (wholeBlocks && offset + length <= plainFrom) {
+                map.erase(map.begin() + offset, map.begin() + offset + length);
+                plainFrom -= length;
+            } else {
+                decryptFrom(offset);
+                map.erase(map.begin() + offset, map.begin() + offset + length);
+            }
+        }
+
+        if (plainFrom < map.size()) {
+            blocks += (map.size() - plainFrom) / aesBlockSize;
+            crypt(plainFrom, map.size(), true);
+        }
+        return blocks;
+    }
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "Crypto.h"
+#include "Records.h"
+#include "Decode.h"
+#include "../stuff/Buffer.h"
+#include "../stuff/ObjectTable.h"
+#include "../stuff/Parallel.h"
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+namespace cpdl {
+
+    // --- Text Import ---
+    // Builds the decrypted bytes of a map holding objects in one table. The template map
+    // supplies the layout and header; a record that existed in the template's first table
+    // keeps that record's bytes outside the decoded fields, later records have zeros there.
+    // The result is padded with zeros to whole AES blocks.
+    inline Buffer encodeMap(const Buffer& templateMap, const RecordLayout& layout, size_t templateRecords,
+                            const ObjectTable& objects) {
+        const size_t recordSize = layout.recordSize;
+        const size_t size = layout.headerSize + objects.size() * recordSize;
+
+        Buffer map;
+        map.resize((size + aesBlockSize - 1) / aesBlockSize * aesBlockSize, 0);
+        std::copy(templateMap.begin(), templateMap.begin() + std::min(layout.headerSize, templateMap.size()),
+                  map.begin());
+
+        const unsigned threads = parallel::ThreadCount(objects.size());
+        parallel::ForChunks(objects.size(), threads, [&](size_t begin, size_t end, unsigned) {
+            for (size_t i = begin; i < end; ++i) {
+                uint8_t* record = map.data() + recordOffset(layout, i);
+                if (i < templateRecords)
+                    std::memcpy(record, templateMap.data() + recordOffset(layout, i), recordSize);
+
+                if (layout.endian == Endian::Big)
+                    writeRecord<Endian::Big>(record, objects[i], layout.fields);
+                else
+                    writeRecord<Endian::Little>(record, objects[i], layout.fields);
+            }
+        });
+
+        return map;
+    }
+
+}
@@ -0,0 +1,411 @@
+#pragma once
+#include "Records.h"
+#include "../stuff/Buffer.h"
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <stdexcept>
+#include <algorithm>
+#include <memory_resource>
+
+namespace cpdl {
+
+    // --- Stride Discovery ---
+    // Records of a fixed stride repeat type IDs and float exponent bytes, so the byte-wise
+    // autocorrelation buffer[i] == buffer[i + lag] peaks at the stride and its multiples.
+    // Most lags are unrelated to the stride, so the median score is the noise floor, and a
+    // lag is a candidate only if it scores at least half way from the floor to the peak.
+    inline std::vector<size_t> discoverStrides(const Buffer& buffer, size_t maxStride, size_t maxCandidates,
+                                               std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+        const size_t minStride = 16; // type + x + y + z
+        const size_t windowSize = 256 * 1024;
+
+        std::vector<size_t> candidates;
+        if (buffer.size() < maxStride * 4)
+            return candidates;
+
+        const size_t window = std::min(buffer.size(), windowSize + maxStride);
+        const uint8_t* data = buffer.data();
+
+        std::pmr::vector<double> score(maxStride + 1, 0.0, resource);
+        for (size_t lag = minStride; lag <= maxStride; ++lag) {
+            const size_t n = window - lag;
+            size_t matches = 0;
+            for (size_t i = 0; i < n; ++i)
+                matches += data[i] == data[i + lag];
+            score[lag] = double(matches) / double(n);
+        }
+
+        std::pmr::vector<size_t> lags(resource);
+        for (size_t lag = minStride; lag <= maxStride; ++lag)
+            lags.push_back(lag);
+        std::sort(lags.begin(), lags.end(), [&](size_t a, size_t b) { return score[a] > score[b]; });
+
+        std::pmr::vector<double> sorted(score.begin() + minStride, score.end(), resource);
+        std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+        const double noiseFloor = sorted[sorted.size() / 2];
+        const double threshold = (noiseFloor + score[lags.front()]) / 2;
+
+        for (size_t lag : lags) {
+            if (candidates.size() >= maxCandidates || score[lag] < threshold)
+                break;
+
+            // A peak spills into the lags either side of it; those fold into the peak.
+            if (score[lag - 1] > score[lag] || (lag < maxStride && score[lag + 1] > score[lag]))
+                continue;
+
+            // Multiples of the stride score about as high as the stride itself; report the
+            // fundamental period instead.
+            size_t fundamental = lag;
+            for (size_t d = minStride; d < lag; ++d) {
+                if (lag % d == 0 && score[d] >= score[lag] * 0.9) {
+                    fundamental = d;
+                    break;
+                }
+            }
+
+            bool known = false;
+            for (size_t c : candidates)
+                known = known || fundamental % c == 0;
+            if (!known)
+                candidates.push_back(fundamental);
+        }
+
+        return candidates;
+    }
+
+    // --- Record Size Guesser ---
+    template <Endian E>
+    size_t countRecords(const Buffer& buffer, size_t offset, size_t recordSize, const FieldOffsets& fields,
+                        size_t limit) {
+        size_t count = 0;
+        while (count < limit && offset + recordSize <= buffer.size() &&
+               isReasonableRecord(readRecord<E>(buffer.data() + offset, fields))) {
+            offset += recordSize;
+            ++count;
+        }
+        return count;
+    }
+
+    inline size_t countRecords(const Buffer& buffer, size_t offset, size_t recordSize, Endian endian,
+                               const FieldOffsets& fields, size_t limit) {
+        return endian == Endian::Big
+            ? countRecords<Endian::Big>(buffer, offset, recordSize, fields, limit)
+            : countRecords<Endian::Little>(buffer, offset, recordSize, fields, limit);
+    }
+
+    // Zero padding and reserved fields decode as plausible records, so only records that
+    // are not blank count towards confirming a table.
+    template <Endian E>
+    size_t countFilledRecords(const Buffer& buffer, size_t offset, size_t recordSize, const FieldOffsets& fields,
+                              size_t limit) {
+        size_t count = 0;
+        while (count < limit && offset + recordSize <= buffer.size()) {
+            const PDLObject record = readRecord<E>(buffer.data() + offset, fields);
+            if (!isReasonableRecord(record) || isBlankRecord(record))
+                break;
+            offset += recordSize;
+            ++count;
+        }
+        return count;
+    }
+
+    inline size_t countFilledRecords(const Buffer& buffer, size_t offset, size_t recordSize, Endian endian,
+                                     const FieldOffsets& fields, size_t limit) {
+        return endian == Endian::Big
+            ? countFilledRecords<Endian::Big>(buffer, offset, recordSize, fields, limit)
+            : countFilledRecords<Endian::Little>(buffer, offset, recordSize, fields, limit);
+    }
+
+    // True if minRun filled records of recordSize follow each other anywhere in buffer, in
+    // either byte order. Detection keeps only the stride candidates that pass, since the
+    // scanner resyncs on every candidate it is given.
+    inline bool hasRecordRun(const Buffer& buffer, size_t recordSize, size_t minRun) {
+        for (size_t offset = 0; offset + recordSize * minRun <= buffer.size(); offset += 4) {
+            if (countFilledRecords<Endian::Little>(buffer, offset, recordSize, FieldOffsets(), minRun) >= minRun ||
+                countFilledRecords<Endian::Big>(buffer, offset, recordSize, FieldOffsets(), minRun) >= minRun)
+                return true;
+        }
+        return false;
+    }
+
+    // Scores every header offset by the run of records it starts. Blank records keep a run
+    // going but score nothing, so zero padding cannot pass for the table. Each record whose
+    // type repeats the previous one scores again: the type field is where the agreement
+    // that revealed the stride comes from, and it sets the true phase apart from offsets
+    // that read other plausible floats, such as a rotation, as coordinates. Ties keep the
+    // lowest offset and little-endian.
+    //
+    // Tests the little- and big-endian hypotheses together, so each header offset is
+    // walked only once and the walk ends as soon as both runs have broken.
+    inline size_t tryRecordSize(const Buffer& buffer, size_t recordSize, size_t& headerSizeOut, Endian& endianOut) {
+        struct Run {
+            bool valid = true;
+            size_t score = 0;
+            uint32_t lastType = 0; // blank records have type 0, so no first record repeats it
+
+            void extend(const PDLObject& record) {
+                valid = valid && isReasonableRecord(record);
+                if (!valid || isBlankRecord(record))
+                    return;
+                score += record.type == lastType ? 2 : 1;
+                lastType = record.type;
+            }
+        };
+
+        size_t bestScore = 0;
+        size_t bestHeader = 0;
+        Endian bestEndian = Endian::Little;
+
+        const size_t headerLimit = std::max<size_t>(64, recordSize);
+        for (size_t headerOffset = 0; headerOffset < headerLimit; headerOffset += 4) {
+            Run runLE, runBE;
+
+            for (size_t offset = headerOffset; (runLE.valid || runBE.valid) && offset + recordSize <= buffer.size();
+                 offset += recordSize) {
+                const uint8_t* base = buffer.data() + offset;
+                runLE.extend(readRecord<Endian::Little>(base));
+                runBE.extend(readRecord<Endian::Big>(base));
+            }
+
+            if (runLE.score > bestScore) {
+                bestScore = runLE.score;
+                bestHeader = headerOffset;
+                bestEndian = Endian::Little;
+            }
+            if (runBE.score > bestScore) {
+                bestScore = runBE.score;
+                bestHeader = headerOffset;
+                bestEndian = Endian::Big;
+            }
+        }
+
+        headerSizeOut = bestHeader;
+        endianOut = bestEndian;
+        return bestScore;
+    }
+
+    // --- Multi-Table Scanner ---
+    // Finds where tables start. After an invalid record the scan slides forward in
+    // resyncStep steps and tests each confirmed record size in both byte orders. Random
+    // bytes pass isReasonableRecord roughly one time in six, so a table has to open with
+    // minRun filled records, which no gap between tables fakes by chance. Where several
+    // hypotheses qualify, the longest run wins, counted up to probeRun records; ties go
+    // to the best record size and then to the previous table's byte order. scanTables
+    // runs it over a whole map and ObjectStream over a sliding window, so both find the
+    // same tables. A later table shorter than minRun is skipped.
+    inline constexpr size_t minTableRun = 16;
+
+    class TableScanner {
+    public:
+        static constexpr size_t resyncStep = 4;
+
+        TableScanner(const RecordLayout& layout, std::vector<size_t> recordSizes, size_t minRun = minTableRun)
+            : layout(layout), recordSizes(std::move(recordSizes)), minRun(minRun), probeRun(minRun * 4),
+              endian(layout.endian) {
+            for (auto size : this->recordSizes)
+                maxRecordSize = std::max(maxRecordSize, size);
+        }
+
+        // Bytes from a probed offset that a probe may read. A window holding them, or
+        // ending where the map ends, gives the same answer as the whole map.
+        size_t lookahead() const { return maxRecordSize * probeRun; }
+        size_t tableCount() const { return tables; }
+
+        // Tests for a table starting at map offset offset, whose bytes are at buffer[at].
+        // A hit fills table, with count 0 since the caller decides how far it runs.
+        bool probe(const Buffer& buffer, size_t at, size_t offset, RecordTable& table) {
+            // The table at the header was already validated by detection.
+            if (tables == 0 && offset == layout.headerSize &&
+                countRecords(buffer, at, layout.recordSize, layout.endian, layout.fields, 1) == 1)
+                return enter(table, offset, layout.recordSize, layout.endian);
+
+            const Endian endians[] = {endian, endian == Endian::Big ? Endian::Little : Endian::Big};
+            size_t bestRun = minRun - 1;
+            size_t bestSize = 0;
+            Endian bestEndian = endian;
+
+            for (auto size : recordSizes) {
+                for (auto e : endians) {
+                    const size_t run = countFilledRecords(buffer, at, size, e, layout.fields, probeRun);
+                    if (run > bestRun) {
+                        bestRun = run;
+                        bestSize = size;
+                        bestEndian = e;
+                    }
+                }
+            }
+
+            return bestSize != 0 && enter(table, offset, bestSize, bestEndian);
+        }
+
+    private:
+        bool enter(RecordTable& table, size_t offset, size_t recordSize, Endian e) {
+            table = RecordTable{offset, recordSize, e, layout.fields, 0, 0};
+            endian = e;
+            ++tables;
+            return true;
+        }
+
+        RecordLayout layout;
+        std::vector<size_t> recordSizes;
+        size_t minRun;
+        size_t probeRun;
+        size_t maxRecordSize = 0;
+        Endian endian;
+        size_t tables = 0;
+    };
+
+    inline std::pmr::vector<RecordTable> scanTables(const Buffer& buffer, const RecordLayout& layout,
+                                                    const std::vector<size_t>& recordSizes, size_t minRun = minTableRun,
+                                                    std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+        std::pmr::vector<RecordTable> tables(resource);
+        TableScanner scanner(layout, recordSizes, minRun);
+        size_t offset = layout.headerSize;
+
+        while (offset + 16 <= buffer.size()) {
+            RecordTable table{};
+            if (!scanner.probe(buffer, offset, offset, table)) {
+                offset += TableScanner::resyncStep;
+                continue;
+            }
+
+            table.count = countRecords(buffer, offset, table.recordSize, table.endian, table.fields, SIZE_MAX);
+            offset += table.count * table.recordSize;
+            tables.push_back(std::move(table));
+        }
+
+        return tables;
+    }
+
+    // --- Layout Detection ---
+    // Returns the tryRecordSize score of the best layout, 0 if nothing decodes.
+    // recordSizesOut receives the best stride and the other candidates that hasRecordRun
+    // confirms.
+    inline size_t detectLayout(const Buffer& buffer, RecordLayout& layoutOut, std::vector<size_t>& recordSizesOut,
+                               std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+        const size_t maxRecordSize = 256;
+        std::vector<size_t> candidateRecordSizes = discoverStrides(buffer, maxRecordSize, 4, resource);
+        if (candidateRecordSizes.empty())
+            candidateRecordSizes = {16, 20, 24, 32};
+
+        size_t bestScore = 0;
+        RecordLayout best;
+
+        for (auto size : candidateRecordSizes) {
+            size_t header;
+            Endian endian;
+            size_t score = tryRecordSize(buffer, size, header, endian);
+
+            if (score > bestScore) {
+                bestScore = score;
+                best.recordSize = size;
+                best.headerSize = header;
+                best.endian = endian;
+            }
+        }
+
+        recordSizesOut = {best.recordSize};
+        for (auto size : candidateRecordSizes) {
+            if (size != best.recordSize && hasRecordRun(buffer, size, minTableRun))
+                recordSizesOut.push_back(size);
+        }
+
+        layoutOut = best;
+        return bestScore;
+    }
+
+    // --- Layout Descriptors ---
+    // One layout per line: "<signature> <record_size> <header_size> <type> <x> <y> <z> <le|be>".
+    // Maps from one game build share a layout and start with the same bytes, so the hex of
+    // the first decrypted bytes is the lookup key.
+    inline constexpr size_t layoutSignatureSize = 8;
+
+    inline std::string layoutSignature(const Buffer& buffer) {
+        static const char digits[] = "0123456789abcdef";
+        std::string signature;
+        for (size_t i = 0; i < std::min(layoutSignatureSize, buffer.size()); ++i) {
+            signature += digits[buffer[i] >> 4];
+            signature += digits[buffer[i] & 0xF];
+        }
+        return signature;
+    }
+
+    inline std::string formatLayout(const std::string& signature, const RecordLayout& layout) {
+        std::ostringstream line;
+        line << signature << " " << layout.recordSize << " " << layout.headerSize << " "
+             << layout.fields.type << " " << layout.fields.x << " " << layout.fields.y << " " << layout.fields.z << " "
+             << (layout.endian == Endian::Big ? "be" : "le") << "\n";
+        return line.str();
+    }
+
+    using LayoutCatalog = std::unordered_map<std::string, RecordLayout>;
+
+    // A missing file is an empty set of layouts, so the first --save-layout run can create it.
+    inline LayoutCatalog loadLayouts(const std::string& filename) {
+        LayoutCatalog layouts;
+        std::ifstream file(filename);
+        if (!file)
+            return layouts;
+
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            std::istringstream fields(line);
+            std::string signature, endian;
+            RecordLayout layout;
+            fields >> signature >> layout.recordSize >> layout.headerSize
+                   >> layout.fields.type >> layout.fields.x >> layout.fields.y >> layout.fields.z >> endian;
+
+            const size_t extent = std::max({layout.fields.type, layout.fields.x, layout.fields.y, layout.fields.z}) + 4;
+            if (!fields || (endian != "le" && endian != "be") || extent > layout.recordSize)
+                throw std::runtime_error("Malformed layout descriptor: " + line);
+
+            layout.endian = endian == "be" ? Endian::Big : Endian::Little;
+            layouts[signature] = layout;
+        }
+
+        return layouts;
+    }
+
+    // --- Layout Lookup ---
+    // A map's layout comes from the catalogue when its signature is listed and is detected
+    // otherwise. Detection only looks at the first layoutDetectionSize bytes, so a whole
+    // map, a --offset range and an ObjectStream all settle on the same layout, and a
+    // caller without the catalogue entry needs only that prefix decrypted.
+    inline constexpr size_t layoutDetectionSize = 1024 * 1024;
+
+    struct LayoutMatch {
+        std::string signature;
+        RecordLayout layout;
+        std::vector<size_t> recordSizes; // stride candidates for the scanner, best first
+        bool known = false;              // taken from the catalogue, detection skipped
+        bool found = false;              // false when nothing decodes
+    };
+
+    inline LayoutMatch matchLayout(const Buffer& decrypted, const LayoutCatalog& knownLayouts,
+                                   std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+        LayoutMatch match;
+        match.signature = layoutSignature(decrypted);
+
+        auto known = knownLayouts.find(match.signature);
+        if (known != knownLayouts.end()) {
+            match.layout = known->second;
+            match.recordSizes = {match.layout.recordSize};
+            match.known = match.found = true;
+        } else if (decrypted.size() > layoutDetectionSize) {
+            const Buffer prefix(std::vector<uint8_t>(decrypted.begin(), decrypted.begin() + layoutDetectionSize));
+            match.found = detectLayout(prefix, match.layout, match.recordSizes, resource) > 0;
+        } else {
+            match.found = detectLayout(decrypted, match.layout, match.recordSizes, resource) > 0;
+        }
+        return match;
+    }
+
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include "Crypto.h"
+#include "Layout.h"
+#include "Decode.h"
+#include "../stuff/Buffer.h"
+#include "../stuff/FileLoader.h"
+#include "../stuff/ObjectTable.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <memory_resource>
+#include <utility>
+#include <algorithm>
+
+namespace cpdl {
+
+    // A decrypted map with its layout and the record tables found in it. Views and
+    // decoders read the records straight from buffer.
+    struct Map {
+        Buffer buffer;
+        std::string signature;
+        RecordLayout layout;
+        bool knownLayout = false; // layout taken from the catalogue, detection skipped
+        std::pmr::vector<RecordTable> tables;
+
+        size_t objectCount() const {
+            size_t count = 0;
+            for (const auto& table : tables)
+                count += table.count;
+            return count;
+        }
+    };
+
+    inline Buffer decrypt(Buffer encrypted, const std::string& key = defaultKey) {
+        return decryptAES128ECB(std::move(encrypted), key);
+    }
+
+    inline Buffer encrypt(Buffer decrypted, const std::string& key = defaultKey) {
+        return encryptAES128ECB(std::move(decrypted), key);
+    }
+
+    // Finds the tables of a decrypted map, with the layout from matchLayout. No tables
+    // means no layout decoded.
+    inline Map parse(Buffer decrypted, const LayoutCatalog& knownLayouts = LayoutCatalog(),
+                     std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+        LayoutMatch match = matchLayout(decrypted, knownLayouts, resource);
+        Map map{std::move(decrypted), std::move(match.signature), match.layout, match.known,
+                std::pmr::vector<RecordTable>(resource)};
+        if (match.found)
+            map.tables = scanTables(map.buffer, map.layout, match.recordSizes, minTableRun, resource);
+        return map;
+    }
+
+    // Reads, decrypts and parses a map file.
+    inline Map load(const std::string& path, const LayoutCatalog& knownLayouts = LayoutCatalog(),
+                    const std::string& key = defaultKey,
+                    std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+        return parse(decrypt(fileLoader::Load(path), key), knownLayouts, resource);
+    }
+
+    // The layout of a map file from as little of it as matchLayout needs: the first AES
+    // block when the catalogue lists its signature, the detection prefix otherwise.
+    inline LayoutMatch matchFileLayout(const std::string& path, const LayoutCatalog& knownLayouts = LayoutCatalog(),
+                                       const std::string& key = defaultKey) {
+        Buffer head = decrypt(fileLoader::LoadRange(path, 0, aesBlockSize), key);
+        if (knownLayouts.find(layoutSignature(head)) == knownLayouts.end())
+            head = decrypt(fileLoader::LoadRange(path, 0, layoutDetectionSize), key);
+        return matchLayout(head, knownLayouts);
+    }
+
+    // --- Record Ranges ---
+    // Records first .. first + count of the table at the header, read from a map file
+    // without loading the rest. Record i sits at headerSize + i * recordSize, so once
+    // matchFileLayout has the layout only the AES blocks covering those records are read
+    // and decrypted. The grid ends with that table: past it lie gaps, padding or tables of
+    // another stride, so the range stops at the first implausible record. A map is paged
+    // through by moving first on by table.count until a range comes back empty.
+    struct RecordRange {
+        LayoutMatch match;
+        size_t first = 0;       // index of the first record, clamped to the records the file holds
+        size_t requested = 0;   // records asked for that the file can hold
+        RecordTable table{};    // the records read, at their map offset; none without a layout
+        Buffer window;          // decrypted AES blocks covering the requested records
+        size_t windowBegin = 0; // map offset of window[0]
+
+        // The first record's bytes, for visitTable(range.records(), range.table, fn).
+        const uint8_t* records() const { return window.data() + (table.offset - windowBegin); }
+    };
+
+    inline RecordRange readRange(const std::string& path, const LayoutCatalog& knownLayouts, size_t first, size_t count,
+                                 const std::string& key = defaultKey) {
+        RecordRange range;
+        range.match = matchFileLayout(path, knownLayouts, key);
+        if (!range.match.found)
+            return range;
+
+        // Records that fit in the file, an upper bound for the table.
+        const RecordLayout& layout = range.match.layout;
+        const size_t fileSize = fileLoader::Size(path);
+        const size_t available = fileSize > layout.headerSize ? (fileSize - layout.headerSize) / layout.recordSize : 0;
+        range.first = std::min(first, available);
+        range.requested = std::min(count, available - range.first);
+
+        const size_t begin = recordOffset(layout, range.first);
+        const size_t end = begin + range.requested * layout.recordSize;
+        range.windowBegin = begin / aesBlockSize * aesBlockSize;
+        const size_t windowEnd = (end + aesBlockSize - 1) / aesBlockSize * aesBlockSize;
+        range.window = decrypt(fileLoader::LoadRange(path, range.windowBegin, windowEnd - range.windowBegin), key);
+
+        const size_t valid = countRecords(range.window, begin - range.windowBegin, layout.recordSize, layout.endian,
+                                          layout.fields, range.requested);
+        range.table = RecordTable{begin, layout.recordSize, layout.endian, layout.fields, valid, 0};
+        return range;
+    }
+
+    // Decodes every table of a map into one ObjectTable, in file order.
+    inline ObjectTable decode(Map& map, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+        return decodeTables(map.buffer, map.tables, resource);
+    }
+
+}
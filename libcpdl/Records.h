@@ -0,0 +1,127 @@
+#pragma once
+#include "../stuff/ObjectTable.h"
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#endif
+
+// Record layouts and the endian-aware field readers and writers they decode with.
+namespace cpdl {
+
+    // Subnormals are rejected: they are what a big-endian coordinate with zero low
+    // mantissa bytes, a round number, reads as in little-endian, and no map places
+    // objects that close to zero.
+    inline bool isReasonableCoord(float f) {
+        return std::abs(f) < 100000.0f && std::fpclassify(f) != FP_SUBNORMAL;
+    }
+
+    enum class Endian { Little, Big };
+
+    inline const char* endianName(Endian endian) {
+        return endian == Endian::Big ? "Big Endian" : "Little Endian";
+    }
+
+    // Byte offsets of the decoded fields inside a record.
+    struct FieldOffsets {
+        size_t type = 0;
+        size_t x = 4;
+        size_t y = 8;
+        size_t z = 12;
+
+        bool operator==(const FieldOffsets& other) const {
+            return type == other.type && x == other.x && y == other.y && z == other.z;
+        }
+    };
+
+    struct RecordLayout {
+        size_t recordSize = 0;
+        size_t headerSize = 0;
+        Endian endian = Endian::Little;
+        FieldOffsets fields;
+    };
+
+    struct RecordTable {
+        size_t offset;      // byte offset of the first record
+        size_t recordSize;
+        Endian endian;
+        FieldOffsets fields;
+        size_t count;
+        size_t firstObject; // index of the first decoded record in the ObjectTable
+    };
+
+    // --- Endian Readers ---
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    constexpr Endian hostEndian = Endian::Big;
+#else
+    constexpr Endian hostEndian = Endian::Little;
+#endif
+
+    inline uint32_t byteSwap32(uint32_t value) {
+#if defined(_MSC_VER)
+        return _byteswap_ulong(value);
+#else
+        return __builtin_bswap32(value);
+#endif
+    }
+
+    template <Endian E>
+    uint32_t readUInt32(const uint8_t* data) {
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return E == hostEndian ? value : byteSwap32(value);
+    }
+
+    template <Endian E>
+    float readFloat(const uint8_t* data) {
+        uint32_t temp = readUInt32<E>(data);
+        float result;
+        std::memcpy(&result, &temp, sizeof(result));
+        return result;
+    }
+
+    template <Endian E>
+    PDLObject readRecord(const uint8_t* base, const FieldOffsets& fields = FieldOffsets()) {
+        PDLObject obj;
+        obj.type = readUInt32<E>(base + fields.type);
+        obj.x    = readFloat<E>(base + fields.x);
+        obj.y    = readFloat<E>(base + fields.y);
+        obj.z    = readFloat<E>(base + fields.z);
+        return obj;
+    }
+
+    // --- Endian Writers ---
+    template <Endian E>
+    void writeUInt32(uint8_t* data, uint32_t value) {
+        value = E == hostEndian ? value : byteSwap32(value);
+        std::memcpy(data, &value, sizeof(value));
+    }
+
+    template <Endian E>
+    void writeFloat(uint8_t* data, float value) {
+        uint32_t temp;
+        std::memcpy(&temp, &value, sizeof(temp));
+        writeUInt32<E>(data, temp);
+    }
+
+    template <Endian E>
+    void writeRecord(uint8_t* base, const PDLObject& obj, const FieldOffsets& fields = FieldOffsets()) {
+        writeUInt32<E>(base + fields.type, obj.type);
+        writeFloat<E>(base + fields.x, obj.x);
+        writeFloat<E>(base + fields.y, obj.y);
+        writeFloat<E>(base + fields.z, obj.z);
+    }
+
+    inline bool isReasonableRecord(const PDLObject& obj) {
+        return isReasonableCoord(obj.x) && isReasonableCoord(obj.y) && isReasonableCoord(obj.z);
+    }
+
+    // A record of type 0 or at the origin is what zero padding and reserved fields read as.
+    // It is plausible, but it says nothing about where records start.
+    inline bool isBlankRecord(const PDLObject& obj) {
+        return obj.type == 0 || (obj.x == 0.0f && obj.y == 0.0f && obj.z == 0.0f);
+    }
+
+}
@@ -0,0 +1,193 @@
+#pragma once
+#include "Records.h"
+#include "Crypto.h"
+#include "Layout.h"
+#include "Map.h"
+#include "../stuff/Buffer.h"
+#include "../stuff/ObjectTable.h"
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+namespace cpdl {
+
+    // --- Object Streams ---
+    // The objects of a map file as an input range that reads, decrypts and decodes on
+    // demand. The file is read in chunks into a window that only keeps the bytes from the
+    // current record on, so memory stays at about a chunk plus the scanner's lookahead
+    // whatever the map size, and a consumer that stops early never reads the rest.
+    // Tables are found by the TableScanner that scanTables uses and the layout by
+    // matchLayout, which detects on the same first MiB that cpdl::parse does, so the
+    // stream yields the objects of load() + decode() in the same order.
+    class ObjectStream {
+    public:
+        static constexpr size_t defaultChunkSize = 1024 * 1024;
+
+        class iterator {
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type = PDLObject;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const PDLObject*;
+            using reference = const PDLObject&;
+
+            iterator() = default;
+            explicit iterator(ObjectStream* stream) : stream(stream) { advance(); }
+
+            const PDLObject& operator*() const { return current; }
+            const PDLObject* operator->() const { return &current; }
+            iterator& operator++() { advance(); return *this; }
+            void operator++(int) { advance(); }
+
+            // Only an exhausted iterator compares equal to end().
+            bool operator==(const iterator& other) const { return stream == other.stream; }
+            bool operator!=(const iterator& other) const { return stream != other.stream; }
+
+        private:
+            void advance() {
+                if (stream && !stream->next(current))
+                    stream = nullptr;
+            }
+
+            ObjectStream* stream = nullptr;
+            PDLObject current{};
+        };
+
+        explicit ObjectStream(const std::string& path, const LayoutCatalog& knownLayouts = LayoutCatalog(),
+                              const std::string& key = defaultKey, size_t chunkSize = defaultChunkSize)
+            : file(path, std::ios::binary), key(key),
+              chunkSize(std::max(chunkSize, aesBlockSize) / aesBlockSize * aesBlockSize) {
+            if (!file) throw std::runtime_error("Failed to open file for reading");
+
+            // Only a map missing from the catalogue needs the detection prefix.
+            fill(aesBlockSize);
+            if (knownLayouts.find(cpdl::layoutSignature(window)) == knownLayouts.end())
+                fill(layoutDetectionSize);
+
+            match = matchLayout(window, knownLayouts);
+            if (!match.found) {
+                finished = true;
+                return;
+            }
+
+            scanner.emplace(match.layout, match.recordSizes);
+            offset = match.layout.headerSize;
+        }
+
+        const std::string& layoutSignature() const { return match.signature; }
+        const RecordLayout& layout() const { return match.layout; }
+        bool layoutFromCatalog() const { return match.known; }
+
+        // Tables entered and file bytes read so far.
+        size_t tablesSeen() const { return scanner ? scanner->tableCount() : 0; }
+        size_t bytesRead() const { return fileOffset; }
+
+        // Byte offset, in the decrypted map, of the record next() returned last.
+        size_t recordOffset() const { return lastOffset; }
+
+        // Decodes the next object into out; false once the map is exhausted.
+        bool next(PDLObject& out) {
+            while (!finished) {
+                if (recordSize != 0) {
+                    if (!fill(offset + recordSize - windowBegin))
+                        break;
+
+                    const uint8_t* base = window.data() + (offset - windowBegin);
+                    out = table.endian == Endian::Big
+                        ? readRecord<Endian::Big>(base, table.fields)
+                        : readRecord<Endian::Little>(base, table.fields);
+                    if (isReasonableRecord(out)) {
+                        lastOffset = offset;
+                        offset += recordSize;
+                        return true;
+                    }
+
+                    recordSize = 0;
+                }
+
+                if (!fill(offset + scanner->lookahead() - windowBegin) && offset + 16 > windowBegin + window.size())
+                    break;
+
+                if (scanner->probe(window, offset - windowBegin, offset, table))
+                    recordSize = table.recordSize;
+                else
+                    offset += TableScanner::resyncStep;
+            }
+
+            finished = true;
+            return false;
+        }
+
+        iterator begin() { return iterator(this); }
+        iterator end() { return iterator(); }
+
+    private:
+        // Reads chunks until the window holds size bytes from its start or the file ends.
+        // Bytes before the current offset are dropped first, so the window never grows
+        // past what the scanner still needs plus one chunk. False if the file ended short.
+        bool fill(size_t size) {
+            if (window.size() >= size)
+                return true;
+
+            const size_t drop = std::min(offset, windowBegin + window.size()) - windowBegin;
+            if (drop > 0) {
+                window.erase(window.begin(), window.begin() + drop);
+                windowBegin += drop;
+                size -= drop;
+            }
+
+            while (window.size() < size && !endOfFile) {
+                chunk.resize(chunkSize);
+                file.read(reinterpret_cast<char*>(chunk.data()), chunkSize);
+                const size_t got = static_cast<size_t>(file.gcount());
+                if (got < chunkSize) {
+                    endOfFile = true;
+                    chunk.resize(got);
+                }
+                fileOffset += got;
+
+                // Chunks are whole AES blocks, so only the last one can end in a partial
+                // block, which decryptAES128ECB zeroes as it does for a whole map.
+                chunk = decryptAES128ECB(std::move(chunk), key);
+                window.insert(window.end(), chunk.begin(), chunk.end());
+            }
+            return window.size() >= size;
+        }
+
+        std::ifstream file;
+        std::string key;
+        size_t chunkSize;
+        Buffer chunk;
+        size_t fileOffset = 0;
+        bool endOfFile = false;
+
+        Buffer window;          // decrypted bytes from windowBegin on
+        size_t windowBegin = 0;
+
+        LayoutMatch match;
+        std::optional<TableScanner> scanner;
+
+        size_t offset = 0;      // next byte to decode or scan
+        RecordTable table{};    // the table being decoded
+        size_t recordSize = 0;  // its stride, 0 while scanning
+        size_t lastOffset = 0;
+        bool finished = false;
+    };
+
+    // The objects of a map file in file order, decoded as the range is iterated:
+    //
+    //   for (const PDLObject& object : cpdl::objects("map.pdl"))
+    //       if (object.type == wanted) { ...; break; }  // the rest is never read
+    inline ObjectStream objects(const std::string& path, const LayoutCatalog& knownLayouts = LayoutCatalog(),
+                                const std::string& key = defaultKey,
+                                size_t chunkSize = ObjectStream::defaultChunkSize) {
+        return ObjectStream(path, knownLayouts, key, chunkSize);
+    }
+
+}
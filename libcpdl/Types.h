@@ -0,0 +1,35 @@
+#pragma once
+#include "../stuff/Buffer.h"
+#include "../stuff/ObjectTable.h"
+#include "../stuff/TypeRegistry.h"
+#include "../stuff/ObjectFilter.h"
+#include "../stuff/FlatHashMap.h"
+#include "../stuff/CoordStats.h"
+#include "../stuff/KdTree.h"
+#include "../stuff/Duplicates.h"
+#include "../stuff/QuantizedTable.h"
+#include "../stuff/MapDiff.h"
+
+// The stuff/ types that the libcpdl API takes and returns. They stay declared in the
+// global namespace, where the command line and the other stuff/ utilities use them,
+// and are re-exported here so embedders can spell them cpdl::Buffer, cpdl::ObjectTable
+// and so on. Including libcpdl therefore also brings these global names in.
+namespace cpdl {
+
+    using ::Buffer;
+    using ::PDLObject;
+    using ::Bounds;
+    using ::ObjectTable;
+    using ::TypeRegistry;
+    using ::ObjectFilter;
+    using ::FlatHashMap;
+    using ::AxisStats;
+    using ::CoordStats;
+    using ::Neighbor;
+    using ::DuplicatePair;
+    using ::Duplicates;
+    using ::QuantizedTable;
+    using ::MovedObject;
+    using ::MapDiff;
+
+}
@@ -0,0 +1,335 @@
+#pragma once
+#include "Records.h"
+#include "Decode.h"
+#include "../stuff/ObjectTable.h"
+#include "../stuff/TypeRegistry.h"
+#include "../stuff/FlatHashMap.h"
+#include "../stuff/CoordStats.h"
+#include "../stuff/SpatialGrid.h"
+#include "../stuff/KdTree.h"
+#include "../stuff/RadixSort.h"
+#include "../stuff/Duplicates.h"
+#include "../stuff/QuantizedTable.h"
+#include "../stuff/MapDiff.h"
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+namespace cpdl {
+
+    // --- Writers ---
+    // "<type_id> <type_name> <x> <y> <z>" with six decimals, the object format of every
+    // output and report, and what --import reads back. No newline, so reports can add
+    // their own fields after it.
+    inline void writeObjectLine(std::ostream& out, const PDLObject& o, const TypeRegistry& types) {
+        out << o.type << " " << types.name(o.type) << " "
+            << std::fixed << std::setprecision(6)
+            << o.x << " " << o.y << " " << o.z;
+    }
+
+    template <typename View>
+    void writeObjects(std::ostream& out, const View& view, const TypeRegistry& types) {
+        for (PDLObject o : view) {
+            writeObjectLine(out, o, types);
+            out << "\n";
+        }
+    }
+
+    template <typename View>
+    void writeObjects(std::ostream& out, const View& view, const TypeRegistry& types, const ObjectFilter& filter) {
+        forEachSelected(view, filter, [&](size_t, const PDLObject& o) {
+            writeObjectLine(out, o, types);
+            out << "\n";
+        });
+    }
+
+    // Writes materialized objects in the given index order.
+    inline void writeObjects(std::ostream& out, const ObjectTable& objects, const std::vector<uint32_t>& order,
+                             const TypeRegistry& types) {
+        for (uint32_t index : order) {
+            writeObjectLine(out, objects[index], types);
+            out << "\n";
+        }
+    }
+
+    // Stable grouping by type ID with a radix sort over the type column: groups come out
+    // in ascending ID order and keep the incoming order inside each group.
+    inline std::vector<uint32_t> groupByType(const ObjectTable& objects, std::vector<uint32_t> order) {
+        std::vector<uint32_t> keys(order.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            keys[i] = objects.types()[order[i]];
+
+        radixSort::SortPairs(keys, order);
+        return order;
+    }
+
+    // Writes objects already grouped by type, each group behind a "# group" header.
+    inline void writeGroupedObjects(std::ostream& out, const ObjectTable& objects, const std::vector<uint32_t>& order,
+                                    const TypeRegistry& types) {
+        for (size_t begin = 0; begin < order.size();) {
+            const uint32_t type = objects.types()[order[begin]];
+            size_t end = begin;
+            while (end < order.size() && objects.types()[order[end]] == type)
+                ++end;
+
+            out << "# group " << type << " " << types.name(type) << " count " << end - begin << "\n";
+            for (size_t i = begin; i < end; ++i) {
+                writeObjectLine(out, objects[order[i]], types);
+                out << "\n";
+            }
+            begin = end;
+        }
+    }
+
+    // --- Statistics ---
+    struct TypeStats {
+        size_t count = 0;
+        Bounds bounds = Bounds::empty();
+    };
+
+    // Per-type histogram and bounds, gathered in the same pass that decodes the records.
+    template <typename View>
+    void accumulateTypeStats(const View& view, FlatHashMap<TypeStats>& stats) {
+        for (PDLObject o : view) {
+            TypeStats& entry = stats[o.type];
+            ++entry.count;
+            entry.bounds.extend(o.x, o.y, o.z);
+        }
+    }
+
+    template <typename View>
+    void accumulateTypeStats(const View& view, FlatHashMap<TypeStats>& stats, const ObjectFilter& filter) {
+        forEachSelected(view, filter, [&](size_t, const PDLObject& o) {
+            TypeStats& entry = stats[o.type];
+            ++entry.count;
+            entry.bounds.extend(o.x, o.y, o.z);
+        });
+    }
+
+    inline void writeTypeStats(std::ostream& out, const FlatHashMap<TypeStats>& stats, const TypeRegistry& types,
+                               size_t objectCount) {
+        std::vector<uint32_t> ids;
+        stats.forEach([&](uint32_t id, const TypeStats&) { ids.push_back(id); });
+        std::sort(ids.begin(), ids.end());
+
+        size_t unknownCount = 0;
+        for (uint32_t id : ids)
+            unknownCount += !types.contains(id);
+
+        out << "# objects " << objectCount << " types " << ids.size() << " unknown_types " << unknownCount << "\n";
+        out << "# type_id type_name count min_x min_y min_z max_x max_y max_z\n";
+        out << std::fixed << std::setprecision(6);
+        for (uint32_t id : ids) {
+            const TypeStats& entry = *stats.find(id);
+            out << id << " " << types.name(id) << " " << entry.count << " "
+                << entry.bounds.minX << " " << entry.bounds.minY << " " << entry.bounds.minZ << " "
+                << entry.bounds.maxX << " " << entry.bounds.maxY << " " << entry.bounds.maxZ << "\n";
+        }
+
+        for (uint32_t id : ids) {
+            if (!types.contains(id))
+                out << "# unknown " << id << " " << stats.find(id)->count << "\n";
+        }
+    }
+
+    inline void writeAxisStats(std::ostream& out, const AxisStats& axis) {
+        out << " " << axis.min << " " << axis.max << " " << axis.mean << " " << axis.variance;
+    }
+
+    inline void writeCoordSummary(std::ostream& out, const ObjectTable& objects, const TypeRegistry& types) {
+        out << "# type_id type_name count min_x max_x mean_x var_x min_y max_y mean_y var_y min_z max_z mean_z var_z\n";
+        out << std::fixed << std::setprecision(6);
+
+        const CoordStats all = coordStats::Compute(objects);
+        out << "* all " << all.count;
+        writeAxisStats(out, all.x);
+        writeAxisStats(out, all.y);
+        writeAxisStats(out, all.z);
+        out << "\n";
+
+        for (const auto& entry : coordStats::ComputeByType(objects)) {
+            out << entry.type << " " << types.name(entry.type) << " " << entry.stats.count;
+            writeAxisStats(out, entry.stats.x);
+            writeAxisStats(out, entry.stats.y);
+            writeAxisStats(out, entry.stats.z);
+            out << "\n";
+        }
+    }
+
+    // --- Duplicates ---
+    // One line per pair, with the byte offsets of both records in the map:
+    //   = <offset> <duplicate offset> <object>              byte-identical records
+    //   ~ <offset> <duplicate offset> <object> <distance>   same type within the tolerance
+    inline void writeDuplicates(std::ostream& out, const ObjectTable& objects, const Duplicates& found, float tolerance,
+                                const TypeRegistry& types) {
+        out << "# exact " << found.exact.size() << " near " << found.near.size() << " tolerance " << tolerance << "\n";
+
+        auto writePair = [&](char kind, const DuplicatePair& pair) {
+            out << kind << " " << objects.offset(pair.first) << " " << objects.offset(pair.second) << " ";
+            writeObjectLine(out, objects[pair.first], types);
+        };
+
+        for (const auto& pair : found.exact) {
+            writePair('=', pair);
+            out << "\n";
+        }
+        for (const auto& pair : found.near) {
+            writePair('~', pair);
+            out << " " << pair.distance << "\n";
+        }
+    }
+
+    // --- Map Diff ---
+    // The change list of mapDiff::Compute: a summary line, then "- <index> <object>" for
+    // removed objects, "+ <index> <object>" for added ones and "~ <old index> <new index>
+    // <object> -> <x> <y> <z>" for moved ones, old position first. Indices are object
+    // indices in file order.
+    inline void writeDiff(std::ostream& out, const MapDiff& diff, const ObjectTable& before, const ObjectTable& after,
+                          const TypeRegistry& types) {
+        out << "# unchanged " << diff.unchanged << " moved " << diff.moved.size() << " added " << diff.added.size()
+            << " removed " << diff.removed.size() << "\n";
+        out << std::fixed << std::setprecision(6);
+        for (uint32_t i : diff.removed) {
+            out << "- " << i << " ";
+            writeObjectLine(out, before[i], types);
+            out << "\n";
+        }
+        for (uint32_t j : diff.added) {
+            out << "+ " << j << " ";
+            writeObjectLine(out, after[j], types);
+            out << "\n";
+        }
+        for (const MovedObject& move : diff.moved) {
+            const PDLObject to = after[move.after];
+            out << "~ " << move.before << " " << move.after << " ";
+            writeObjectLine(out, before[move.before], types);
+            out << " -> " << to.x << " " << to.y << " " << to.z << "\n";
+        }
+    }
+
+    // --- Quantization Report ---
+    // Quantizes the map and reports the memory it would take next to the float columns,
+    // the step and error bound of each axis, and the largest error actually measured
+    // after dequantizing every object.
+    inline void writeQuantizationReport(std::ostream& out, const ObjectTable& objects, const QuantizedTable& quantized,
+                                        double dequantizeMs) {
+        const size_t floatBytesPerObject = sizeof(uint32_t) + 3 * sizeof(float);
+        out << "# bits " << quantized.bits() << " objects " << quantized.size() << " types " << quantized.typeCount()
+            << " bytes_per_object " << quantized.bytesPerObject() << " float_bytes_per_object " << floatBytesPerObject
+            << " bytes " << quantized.memoryBytes() << " float_bytes " << objects.size() * floatBytesPerObject
+            << " dequantize_ms " << dequantizeMs << "\n";
+        out << "# axis min max step error_bound max_error\n";
+
+        const size_t block = 4096;
+        std::vector<float> xs(block), ys(block), zs(block);
+        double maxError[3] = {0.0, 0.0, 0.0};
+        for (size_t begin = 0; begin < quantized.size(); begin += block) {
+            const size_t n = std::min(block, quantized.size() - begin);
+            quantized.dequantize(begin, n, xs.data(), ys.data(), zs.data());
+            for (size_t i = 0; i < n; ++i) {
+                maxError[0] = std::max(maxError[0], std::abs(double(xs[i]) - objects.xs()[begin + i]));
+                maxError[1] = std::max(maxError[1], std::abs(double(ys[i]) - objects.ys()[begin + i]));
+                maxError[2] = std::max(maxError[2], std::abs(double(zs[i]) - objects.zs()[begin + i]));
+            }
+        }
+
+        const Bounds& box = quantized.bounds();
+        const float mins[] = {box.minX, box.minY, box.minZ};
+        const float maxs[] = {box.maxX, box.maxY, box.maxZ};
+        const char* axes[] = {"x", "y", "z"};
+        out << std::setprecision(9);
+        for (int axis = 0; axis < 3; ++axis) {
+            out << axes[axis] << " " << mins[axis] << " " << maxs[axis] << " " << quantized.stepSize(axis) << " "
+                << quantized.stepSize(axis) / 2 << " " << maxError[axis] << "\n";
+        }
+    }
+
+    // --- Region Queries ---
+    // Answers a batch of queries, one per line of the queries file:
+    //   box <min_x> <min_y> <min_z> <max_x> <max_y> <max_z>
+    //   radius <x> <y> <z> <r>
+    //   knn <x> <y> <z> <k>
+    //   nearest <x> <y> <z> <type_id>
+    // Each result is a "# <query> : <count>" line followed by the matching objects, nearest
+    // first for knn and nearest. The grid and the k-d tree are built on first use.
+    inline size_t runQueries(std::istream& queries, std::ostream& out, const ObjectTable& objects, const TypeRegistry& types) {
+        std::unique_ptr<SpatialGrid> grid;
+        std::unique_ptr<KdTree> tree;
+        auto spatialGrid = [&]() -> const SpatialGrid& {
+            if (!grid)
+                grid = std::make_unique<SpatialGrid>(objects);
+            return *grid;
+        };
+        auto kdTree = [&]() -> const KdTree& {
+            if (!tree)
+                tree = std::make_unique<KdTree>(objects);
+            return *tree;
+        };
+        auto indicesOf = [](const std::vector<Neighbor>& neighbors) {
+            std::vector<size_t> result;
+            for (const auto& neighbor : neighbors)
+                result.push_back(neighbor.index);
+            return result;
+        };
+
+        size_t count = 0;
+        std::string line;
+        while (std::getline(queries, line)) {
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            std::istringstream fields(line);
+            std::string kind;
+            fields >> kind;
+
+            std::vector<size_t> matches;
+            if (kind == "box") {
+                Bounds box;
+                fields >> box.minX >> box.minY >> box.minZ >> box.maxX >> box.maxY >> box.maxZ;
+                if (fields)
+                    matches = spatialGrid().box(box);
+            } else if (kind == "radius") {
+                float x, y, z, r;
+                fields >> x >> y >> z >> r;
+                if (fields)
+                    matches = spatialGrid().radius(x, y, z, r);
+            } else if (kind == "knn") {
+                float x, y, z;
+                long long k;
+                fields >> x >> y >> z >> k;
+                if (fields && k <= 0)
+                    fields.setstate(std::ios::failbit);
+                if (fields)
+                    matches = indicesOf(kdTree().nearest(x, y, z, size_t(k)));
+            } else if (kind == "nearest") {
+                float x, y, z;
+                uint32_t type;
+                fields >> x >> y >> z >> type;
+                if (fields)
+                    matches = indicesOf(kdTree().nearestOfType(x, y, z, type));
+            } else {
+                fields.setstate(std::ios::failbit);
+            }
+
+            if (!fields)
+                throw std::runtime_error("Malformed query: " + line);
+
+            out << "# " << line << " : " << matches.size() << "\n";
+            for (size_t index : matches) {
+                writeObjectLine(out, objects[index], types);
+                out << "\n";
+            }
+            ++count;
+        }
+
+        return count;
+    }
+
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+// libcpdl: everything the cpdl command line does, as a header-only library.
+//
+//   cpdl::Map map = cpdl::load("map.pdl");            // read, decrypt, detect, scan
+//   cpdl::ObjectTable objects = cpdl::decode(map);      // or visitTable() for views
+//   cpdl::writeObjects(std::cout, objects, order, types);
+//
+//   for (const cpdl::PDLObject& object : cpdl::objects("map.pdl"))  // streamed, chunk by chunk
+//   cpdl::RecordRange page = cpdl::readRange("map.pdl", catalog, first, 1000);  // blocks in range only
+//
+// Types from stuff/ are re-exported into cpdl (see Types.h) but stay global as well.
+// Link with OpenSSL's libcrypto.
+#include "Types.h"
+#include "Records.h"
+#include "Crypto.h"
+#include "Layout.h"
+#include "Decode.h"
+#include "Writers.h"
+#include "Delta.h"
+#include "Import.h"
+#include "Map.h"
+#include "Stream.h"
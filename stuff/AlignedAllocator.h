@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+// Allocator for column storage that starts every block on an Alignment-byte boundary,
+// so vectorized loops over a column begin on a cache line. Memory comes from a
+// std::pmr::memory_resource, which lets a per-map arena back the columns.
+template <typename T, size_t Alignment = 64>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+    AlignedAllocator(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : resource(resource) {}
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>& other) : resource(other.resource) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(resource->allocate(n * sizeof(T), Alignment));
+    }
+
+    void deallocate(T* p, size_t n) {
+        resource->deallocate(p, n * sizeof(T), Alignment);
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>& other) const { return resource == other.resource; }
+
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>& other) const { return resource != other.resource; }
+
+    std::pmr::memory_resource* resource;
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
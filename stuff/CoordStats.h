@@ -0,0 +1,149 @@
+#pragma once
+#include "ObjectTable.h"
+#include "FlatHashMap.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+struct AxisStats {
+    float min;
+    float max;
+    double mean;
+    double variance;
+};
+
+struct CoordStats {
+    size_t count;
+    AxisStats x, y, z;
+};
+
+struct TypeCoordStats {
+    uint32_t type;
+    CoordStats stats;
+};
+
+namespace coordStats {
+
+    // Min, max and the sums of (v - shift) and (v - shift)^2 in doubles. Shifting by one
+    // sample keeps the single-pass variance from cancelling on far-off coordinates.
+    inline AxisStats Column(const float* values, size_t count) {
+        if (count == 0)
+            return {0.0f, 0.0f, 0.0, 0.0};
+
+        const float shift = values[0];
+        float lo = values[0];
+        float hi = values[0];
+        double sum = 0.0;
+        double sumSq = 0.0;
+        size_t i = 0;
+
+#if defined(__SSE2__)
+        __m128 vlo = _mm_set1_ps(lo);
+        __m128 vhi = _mm_set1_ps(hi);
+        const __m128d vshift = _mm_set1_pd(shift);
+        __m128d vsum = _mm_setzero_pd();
+        __m128d vsumSq = _mm_setzero_pd();
+
+        for (; i + 4 <= count; i += 4) {
+            const __m128 v = _mm_loadu_ps(values + i);
+            vlo = _mm_min_ps(vlo, v);
+            vhi = _mm_max_ps(vhi, v);
+
+            const __m128d low = _mm_sub_pd(_mm_cvtps_pd(v), vshift);
+            const __m128d high = _mm_sub_pd(_mm_cvtps_pd(_mm_movehl_ps(v, v)), vshift);
+            vsum = _mm_add_pd(vsum, _mm_add_pd(low, high));
+            vsumSq = _mm_add_pd(vsumSq, _mm_add_pd(_mm_mul_pd(low, low), _mm_mul_pd(high, high)));
+        }
+
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, vlo);
+        lo = std::min({lo, lanes[0], lanes[1], lanes[2], lanes[3]});
+        _mm_store_ps(lanes, vhi);
+        hi = std::max({hi, lanes[0], lanes[1], lanes[2], lanes[3]});
+
+        alignas(16) double pair[2];
+        _mm_store_pd(pair, vsum);
+        sum = pair[0] + pair[1];
+        _mm_store_pd(pair, vsumSq);
+        sumSq = pair[0] + pair[1];
+#endif
+
+        for (; i < count; ++i) {
+            const float v = values[i];
+            lo = v < lo ? v : lo;
+            hi = v > hi ? v : hi;
+            const double d = double(v) - shift;
+            sum += d;
+            sumSq += d * d;
+        }
+
+        const double n = double(count);
+        const double meanShifted = sum / n;
+        return {lo, hi, shift + meanShifted, std::max(0.0, sumSq / n - meanShifted * meanShifted)};
+    }
+
+    inline CoordStats Columns(const float* xs, const float* ys, const float* zs, size_t count) {
+        return {count, Column(xs, count), Column(ys, count), Column(zs, count)};
+    }
+
+    // Population statistics over every object.
+    inline CoordStats Compute(const ObjectTable& objects) {
+        return Columns(objects.xs(), objects.ys(), objects.zs(), objects.size());
+    }
+
+    // Regroups the coordinate columns by type with a counting sort, then runs the
+    // column kernel over each contiguous group. Results are ordered by type ID.
+    inline std::vector<TypeCoordStats> ComputeByType(const ObjectTable& objects) {
+        const size_t count = objects.size();
+        const uint32_t* types = objects.types();
+
+        FlatHashMap<size_t> groupOf(std::min<size_t>(count, 1 << 16));
+        std::vector<uint32_t> groupTypes;
+        std::vector<size_t> groupIndex(count);
+        for (size_t i = 0; i < count; ++i) {
+            size_t& group = groupOf[types[i]];
+            if (group == 0) {
+                groupTypes.push_back(types[i]);
+                group = groupTypes.size();
+            }
+            groupIndex[i] = group - 1;
+        }
+
+        std::vector<size_t> order(groupTypes.size());
+        for (size_t g = 0; g < order.size(); ++g)
+            order[g] = g;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return groupTypes[a] < groupTypes[b]; });
+
+        std::vector<size_t> start(groupTypes.size() + 1, 0);
+        std::vector<size_t> rank(groupTypes.size());
+        for (size_t r = 0; r < order.size(); ++r)
+            rank[order[r]] = r;
+        for (size_t i = 0; i < count; ++i)
+            ++start[rank[groupIndex[i]] + 1];
+        for (size_t r = 0; r < order.size(); ++r)
+            start[r + 1] += start[r];
+
+        AlignedVector<float> xs(count), ys(count), zs(count);
+        std::vector<size_t> cursor(start.begin(), start.end() - 1);
+        for (size_t i = 0; i < count; ++i) {
+            const size_t to = cursor[rank[groupIndex[i]]]++;
+            xs[to] = objects.xs()[i];
+            ys[to] = objects.ys()[i];
+            zs[to] = objects.zs()[i];
+        }
+
+        std::vector<TypeCoordStats> result;
+        result.reserve(order.size());
+        for (size_t r = 0; r < order.size(); ++r) {
+            const size_t first = start[r];
+            const size_t n = start[r + 1] - first;
+            result.push_back({groupTypes[order[r]], Columns(xs.data() + first, ys.data() + first, zs.data() + first, n)});
+        }
+        return result;
+    }
+
+}
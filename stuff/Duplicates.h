@@ -0,0 +1,123 @@
+#pragma once
+#include "ObjectTable.h"
+#include "Buffer.h"
+#include "FlatHashMap.h"
+#include "SpatialGrid.h"
+#include "Parallel.h"
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+// A later object that repeats an earlier one, by object index.
+struct DuplicatePair {
+    uint32_t first;
+    uint32_t second;
+    float distance;
+};
+
+struct Duplicates {
+    std::vector<DuplicatePair> exact; // byte-identical records, distance 0
+    std::vector<DuplicatePair> near;  // same type within the tolerance
+};
+
+namespace duplicates {
+
+    // The whole record, not only type and position: rotation, flags and the other
+    // fields must match too.
+    struct Record {
+        const uint8_t* data;
+        size_t size;
+
+        bool operator==(const Record& other) const {
+            return size == other.size && std::memcmp(data, other.data, size) == 0;
+        }
+    };
+
+    inline Record RecordOf(const ObjectTable& objects, const Buffer& map, size_t i) {
+        const size_t offset = objects.offset(i), size = objects.stride(i);
+        if (offset + size > map.size())
+            throw std::out_of_range("Object record lies outside the map");
+        return {map.data() + offset, size};
+    }
+
+    inline uint32_t RecordHash(const Record& record) {
+        uint32_t h = uint32_t(record.size);
+        size_t i = 0;
+        for (; i + 4 <= record.size; i += 4) {
+            uint32_t v;
+            std::memcpy(&v, record.data + i, sizeof(v));
+            h = (h ^ v) * 0x9E3779B1u + (h >> 15);
+        }
+        for (; i < record.size; ++i)
+            h = (h ^ record.data[i]) * 0x9E3779B1u + (h >> 15);
+        return h;
+    }
+
+    // map is the decrypted map the objects were decoded from. Exact duplicates come from a
+    // hash of the full record bytes: FlatHashMap keeps the first object of every hash and
+    // chains later ones, and each object pairs with the first identical record. The near
+    // phase then looks at one representative per distinct record, so a stack of copies costs
+    // one grid query rather than a quadratic number of pairs. A grid with tolerance-sized
+    // cells is the broad phase, walked in cell order on parallel chunks; pairs of the same
+    // type within the tolerance are reported once, lower index first, sorted by index.
+    inline Duplicates Find(const ObjectTable& objects, const Buffer& map, float tolerance, unsigned threads = 0) {
+        const uint32_t none = UINT32_MAX;
+        const size_t n = objects.size();
+        Duplicates result;
+
+        FlatHashMap<uint32_t> heads(n);
+        std::vector<uint32_t> next(n, none);
+        std::vector<uint32_t> representatives;
+        for (size_t i = 0; i < n; ++i) {
+            const Record record = RecordOf(objects, map, i);
+            uint32_t& head = heads[RecordHash(record)];
+            uint32_t original = head ? head - 1 : none;
+            while (original != none && !(RecordOf(objects, map, original) == record))
+                original = next[original];
+
+            if (original != none) {
+                result.exact.push_back({original, uint32_t(i), 0.0f});
+                continue;
+            }
+
+            // Chain distinct records only; the first copy stands for the rest.
+            next[i] = head ? head - 1 : none;
+            head = uint32_t(i) + 1;
+            representatives.push_back(uint32_t(i));
+        }
+
+        if (!(tolerance > 0.0f) || representatives.empty())
+            return result;
+
+        std::vector<float> xs(representatives.size()), ys(representatives.size()), zs(representatives.size());
+        for (size_t k = 0; k < representatives.size(); ++k) {
+            xs[k] = objects.xs()[representatives[k]];
+            ys[k] = objects.ys()[representatives[k]];
+            zs[k] = objects.zs()[representatives[k]];
+        }
+
+        if (threads == 0)
+            threads = parallel::ThreadCount(representatives.size());
+        const SpatialGrid grid(xs.data(), ys.data(), zs.data(), xs.size(), tolerance, threads);
+
+        std::vector<std::vector<DuplicatePair>> nearOf(threads);
+        grid.queryPairs(tolerance, threads, [&](size_t k, size_t other, unsigned chunk) {
+            const uint32_t a = representatives[k], b = representatives[other];
+            if (objects.types()[a] != objects.types()[b])
+                return;
+            const float dx = xs[other] - xs[k], dy = ys[other] - ys[k], dz = zs[other] - zs[k];
+            nearOf[chunk].push_back({a, b, std::sqrt(dx * dx + dy * dy + dz * dz)});
+        });
+
+        for (const auto& pairs : nearOf)
+            result.near.insert(result.near.end(), pairs.begin(), pairs.end());
+        std::sort(result.near.begin(), result.near.end(), [](const DuplicatePair& a, const DuplicatePair& b) {
+            return a.first != b.first ? a.first < b.first : a.second < b.second;
+        });
+        return result;
+    }
+
+}
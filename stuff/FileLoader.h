@@ -2,6 +2,7 @@
 #include "Buffer.h"
 #include <fstream>
 #include <string>
+#include <algorithm>
 
 namespace fileLoader {
 
@@ -21,6 +22,33 @@ namespace fileLoader {
         return buf;
     }
 
+    inline size_t Size(const std::string& filename) {
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        if (!file) throw std::runtime_error("Failed to open file for reading");
+
+        return static_cast<size_t>(file.tellg());
+    }
+
+    // Reads up to size bytes starting at offset; the result is shorter near the end of the file.
+    inline Buffer LoadRange(const std::string& filename, size_t offset, size_t size) {
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        if (!file) throw std::runtime_error("Failed to open file for reading");
+
+        size_t fileSize = static_cast<size_t>(file.tellg());
+        if (offset >= fileSize) return Buffer();
+        size = std::min(size, fileSize - offset);
+
+        file.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+
+        Buffer buf;
+        buf.resize(size);
+
+        if (!file.read(reinterpret_cast<char*>(buf.data()), size))
+            throw std::runtime_error("Failed to read file");
+
+        return buf;
+    }
+
     inline void Save(const std::string& filename, const Buffer& data) {
         std::ofstream file(filename, std::ios::binary);
         if (!file) throw std::runtime_error("Failed to open file for writing");
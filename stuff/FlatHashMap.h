@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+
+// Open-addressing hash map from 32-bit keys with linear probing. Keys, values and
+// occupancy live in flat arrays, so a hit is usually one cache line and inserting
+// never allocates until the table grows past half full.
+template <typename V>
+class FlatHashMap {
+public:
+    explicit FlatHashMap(size_t expected = 16) { reserve(expected); }
+
+    void reserve(size_t expected) {
+        size_t capacity = 16;
+        while (capacity < expected * 2)
+            capacity <<= 1;
+        if (capacity > keys.size())
+            rehash(capacity);
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    V& operator[](uint32_t key) {
+        size_t slot = probe(key);
+        if (used[slot])
+            return values[slot];
+
+        if ((count + 1) * 2 > keys.size()) {
+            rehash(keys.size() * 2);
+            slot = probe(key);
+        }
+
+        keys[slot] = key;
+        values[slot] = V();
+        used[slot] = 1;
+        ++count;
+        return values[slot];
+    }
+
+    const V* find(uint32_t key) const {
+        size_t slot = probe(key);
+        return used[slot] ? &values[slot] : nullptr;
+    }
+
+    // Calls fn(key, value) for every entry, in slot order.
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (size_t slot = 0; slot < keys.size(); ++slot) {
+            if (used[slot])
+                fn(keys[slot], values[slot]);
+        }
+    }
+
+private:
+    static size_t hash(uint32_t key) {
+        key ^= key >> 16;
+        key *= 0x85EBCA6Bu;
+        key ^= key >> 13;
+        key *= 0xC2B2AE35u;
+        key ^= key >> 16;
+        return key;
+    }
+
+    // Slot holding key, or the empty slot where it would be inserted.
+    size_t probe(uint32_t key) const {
+        const size_t mask = keys.size() - 1;
+        size_t slot = hash(key) & mask;
+        while (used[slot] && keys[slot] != key)
+            slot = (slot + 1) & mask;
+        return slot;
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<uint32_t> oldKeys = std::move(keys);
+        std::vector<V> oldValues = std::move(values);
+        std::vector<uint8_t> oldUsed = std::move(used);
+
+        keys.assign(capacity, 0);
+        values.assign(capacity, V());
+        used.assign(capacity, 0);
+
+        for (size_t slot = 0; slot < oldKeys.size(); ++slot) {
+            if (oldUsed[slot]) {
+                size_t to = probe(oldKeys[slot]);
+                keys[to] = oldKeys[slot];
+                values[to] = std::move(oldValues[slot]);
+                used[to] = 1;
+            }
+        }
+    }
+
+    std::vector<uint32_t> keys;
+    std::vector<V> values;
+    std::vector<uint8_t> used;
+    size_t count = 0;
+};
@@ -0,0 +1,164 @@
+#pragma once
+#include "ObjectTable.h"
+#include "Parallel.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <limits>
+
+struct Neighbor {
+    size_t index;
+    float distanceSq;
+};
+
+// Implicit k-d tree: the node of range [lo, hi) is its middle element, with the left
+// subtree in [lo, mid) and the right in [mid + 1, hi), so no child pointers are
+// stored. Positions are kept in tree order in separate columns, and each node splits
+// on the axis along which its range is widest.
+class KdTree {
+public:
+    explicit KdTree(const ObjectTable& objects, unsigned threads = 0) {
+        const size_t count = objects.size();
+        std::vector<uint32_t> order(count);
+        for (size_t i = 0; i < count; ++i)
+            order[i] = uint32_t(i);
+
+        axes.resize(count);
+        if (threads == 0)
+            threads = parallel::ThreadCount(count);
+
+        // Subtrees are built on their own threads down to a depth that gives each
+        // worker one.
+        unsigned spawnDepth = 0;
+        while ((1u << spawnDepth) < threads)
+            ++spawnDepth;
+        build(objects, order, 0, count, spawnDepth);
+
+        indices.resize(count);
+        types.resize(count);
+        xs.resize(count);
+        ys.resize(count);
+        zs.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            const uint32_t source = order[i];
+            indices[i] = source;
+            types[i] = objects.types()[source];
+            xs[i] = objects.xs()[source];
+            ys[i] = objects.ys()[source];
+            zs[i] = objects.zs()[source];
+        }
+    }
+
+    size_t size() const { return indices.size(); }
+
+    // The k objects closest to (x, y, z), nearest first.
+    std::vector<Neighbor> nearest(float x, float y, float z, size_t k) const {
+        return nearestIf(x, y, z, k, [](size_t) { return true; });
+    }
+
+    // The k objects of one type closest to (x, y, z), nearest first.
+    std::vector<Neighbor> nearestOfType(float x, float y, float z, uint32_t type, size_t k = 1) const {
+        return nearestIf(x, y, z, k, [&](size_t node) { return types[node] == type; });
+    }
+
+private:
+    struct Search {
+        float x, y, z;
+        size_t k;
+        std::vector<Neighbor> heap; // max-heap on distance, holds node positions
+
+        float worst() const {
+            return heap.size() < k ? std::numeric_limits<float>::infinity() : heap.front().distanceSq;
+        }
+    };
+
+    static bool fartherFirst(const Neighbor& a, const Neighbor& b) {
+        return a.distanceSq < b.distanceSq;
+    }
+
+    template <typename Pred>
+    std::vector<Neighbor> nearestIf(float x, float y, float z, size_t k, Pred&& accept) const {
+        Search search{x, y, z, k, {}};
+        if (k == 0 || size() == 0)
+            return {};
+
+        search.heap.reserve(std::min(k, size()));
+        descend(search, 0, size(), accept);
+
+        std::sort_heap(search.heap.begin(), search.heap.end(), fartherFirst);
+        for (auto& neighbor : search.heap)
+            neighbor.index = indices[neighbor.index];
+        return search.heap;
+    }
+
+    template <typename Pred>
+    void descend(Search& search, size_t lo, size_t hi, Pred& accept) const {
+        while (lo < hi) {
+            const size_t mid = lo + (hi - lo) / 2;
+            const float dx = xs[mid] - search.x;
+            const float dy = ys[mid] - search.y;
+            const float dz = zs[mid] - search.z;
+            const float distanceSq = dx * dx + dy * dy + dz * dz;
+
+            if (distanceSq < search.worst() && accept(mid)) {
+                if (search.heap.size() == search.k) {
+                    std::pop_heap(search.heap.begin(), search.heap.end(), fartherFirst);
+                    search.heap.pop_back();
+                }
+                search.heap.push_back({mid, distanceSq});
+                std::push_heap(search.heap.begin(), search.heap.end(), fartherFirst);
+            }
+
+            const float delta = axes[mid] == 0 ? -dx : axes[mid] == 1 ? -dy : -dz;
+            const bool goLeft = delta < 0.0f;
+            const size_t nearLo = goLeft ? lo : mid + 1, nearHi = goLeft ? mid : hi;
+            const size_t farLo = goLeft ? mid + 1 : lo, farHi = goLeft ? hi : mid;
+
+            descend(search, nearLo, nearHi, accept);
+            if (delta * delta >= search.worst())
+                return;
+
+            // Tail-iterate into the far side.
+            lo = farLo;
+            hi = farHi;
+        }
+    }
+
+    static float coord(const ObjectTable& objects, uint32_t index, uint8_t axis) {
+        return axis == 0 ? objects.xs()[index] : axis == 1 ? objects.ys()[index] : objects.zs()[index];
+    }
+
+    void build(const ObjectTable& objects, std::vector<uint32_t>& order, size_t lo, size_t hi, unsigned spawnDepth) {
+        if (hi - lo == 0)
+            return;
+
+        Bounds range = Bounds::empty();
+        for (size_t i = lo; i < hi; ++i)
+            range.extend(objects.xs()[order[i]], objects.ys()[order[i]], objects.zs()[order[i]]);
+
+        const float spreads[] = {range.maxX - range.minX, range.maxY - range.minY, range.maxZ - range.minZ};
+        const uint8_t axis = uint8_t(std::max_element(spreads, spreads + 3) - spreads);
+
+        const size_t mid = lo + (hi - lo) / 2;
+        std::nth_element(order.begin() + lo, order.begin() + mid, order.begin() + hi,
+            [&](uint32_t a, uint32_t b) { return coord(objects, a, axis) < coord(objects, b, axis); });
+        axes[mid] = axis;
+
+        const size_t minParallel = 1 << 14;
+        if (spawnDepth > 0 && hi - lo >= minParallel) {
+            std::thread left([&, lo, mid]() { build(objects, order, lo, mid, spawnDepth - 1); });
+            build(objects, order, mid + 1, hi, spawnDepth - 1);
+            left.join();
+        } else {
+            build(objects, order, lo, mid, 0);
+            build(objects, order, mid + 1, hi, 0);
+        }
+    }
+
+    std::vector<uint8_t> axes;
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> types;
+    AlignedVector<float> xs, ys, zs;
+};
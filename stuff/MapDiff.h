@@ -0,0 +1,217 @@
+#pragma once
+#include "ObjectTable.h"
+#include "SpatialGrid.h"
+#include "Parallel.h"
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+struct MovedObject {
+    uint32_t before;
+    uint32_t after;
+};
+
+// Indices into the two maps. Objects matched at the same position are only counted.
+struct MapDiff {
+    size_t unchanged = 0;
+    std::vector<MovedObject> moved;
+    std::vector<uint32_t> removed; // indices into the older map
+    std::vector<uint32_t> added;   // indices into the newer map
+};
+
+namespace mapDiff {
+
+    // An object as the join sees it: its key hash, its index and its fields, so
+    // comparing keys never reaches back into the ObjectTable columns.
+    struct Entry {
+        uint32_t hash;
+        uint32_t index;
+        uint32_t type;
+        float x, y, z;
+    };
+
+    // Smallest tolerance Compute uses; smaller ones are raised to it. Coordinates the
+    // scanner accepts stay below 1e5 in magnitude, so at this tolerance every position is
+    // well inside int64_t steps; away from the origin, float spacing is coarser anyway.
+    inline constexpr float minTolerance = 1e-6f;
+
+    // Nearest multiple of the tolerance, in tolerance steps. Positions beyond the range
+    // of the steps saturate instead of overflowing.
+    inline int64_t Quantize(float v, double scale) {
+        const double limit = 4611686018427387904.0; // 2^62
+        const double t = std::clamp(double(v) * scale + 0.5, -limit, limit);
+        const int64_t q = int64_t(t);
+        return q - (double(q) > t);
+    }
+
+    inline bool SameKey(const Entry& a, const Entry& b, double scale) {
+        return a.type == b.type && Quantize(a.x, scale) == Quantize(b.x, scale) &&
+               Quantize(a.y, scale) == Quantize(b.y, scale) && Quantize(a.z, scale) == Quantize(b.z, scale);
+    }
+
+    inline uint32_t Hash(uint32_t type, float x, float y, float z, double scale) {
+        uint64_t h = type;
+        for (int64_t v : {Quantize(x, scale), Quantize(y, scale), Quantize(z, scale)}) {
+            h ^= uint64_t(v) + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+            h *= 0xFF51AFD7ED558CCDull;
+            h ^= h >> 33;
+        }
+        return uint32_t(h ^ (h >> 32));
+    }
+
+    // Scatters the objects into partitions by the top bits of their key hash.
+    // partitionStart[p] .. partitionStart[p + 1] delimit partition p, in index order.
+    inline void Partition(const ObjectTable& objects, double scale, unsigned bits,
+                          std::vector<Entry>& entries, std::vector<size_t>& partitionStart) {
+        const size_t n = objects.size();
+        const size_t partitions = size_t(1) << bits;
+        auto partitionOf = [&](uint32_t hash) { return bits ? hash >> (32 - bits) : 0u; };
+
+        std::vector<uint32_t> hashes(n);
+        partitionStart.assign(partitions + 1, 0);
+        for (size_t i = 0; i < n; ++i) {
+            hashes[i] = Hash(objects.types()[i], objects.xs()[i], objects.ys()[i], objects.zs()[i], scale);
+            ++partitionStart[partitionOf(hashes[i]) + 1];
+        }
+        for (size_t p = 0; p < partitions; ++p)
+            partitionStart[p + 1] += partitionStart[p];
+
+        std::vector<size_t> cursor(partitionStart.begin(), partitionStart.end() - 1);
+        entries.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            entries[cursor[partitionOf(hashes[i])]++] =
+                {hashes[i], uint32_t(i), objects.types()[i], objects.xs()[i], objects.ys()[i], objects.zs()[i]};
+        }
+    }
+
+    // Matches objects in two passes. The first is a radix-partitioned hash join on
+    // (type, quantized position): both maps are split by hash into partitions small
+    // enough that each one's bucket table stays in cache, and the partitions are joined
+    // in parallel. It pairs the objects that did not move; duplicates at one position
+    // pair up in file order. The rest are matched by type to the nearest unmatched
+    // object within moveRadius, found through a grid with one cell per moveRadius. Both
+    // passes are near-linear in the object count.
+    inline MapDiff Compute(const ObjectTable& before, const ObjectTable& after, float tolerance, float moveRadius,
+                           unsigned threads = 0) {
+        const uint32_t none = std::numeric_limits<uint32_t>::max();
+        const size_t partitionTarget = 4096;
+        const double scale = 1.0 / double(std::max(tolerance, minTolerance));
+        MapDiff diff;
+
+        unsigned bits = 0;
+        while (bits < 12 && (before.size() >> bits) > partitionTarget)
+            ++bits;
+        const size_t partitions = size_t(1) << bits;
+        if (threads == 0)
+            threads = parallel::ThreadCount(std::max(before.size(), after.size()));
+        threads = unsigned(std::min<size_t>(std::max(1u, threads), partitions));
+
+        // Pass 1: hash join.
+        std::vector<Entry> beforeEntries, afterEntries;
+        std::vector<size_t> beforeStart, afterStart;
+        Partition(before, scale, bits, beforeEntries, beforeStart);
+        Partition(after, scale, bits, afterEntries, afterStart);
+
+        std::vector<uint8_t> matchedBefore(before.size(), 0);
+        std::vector<std::vector<uint32_t>> unmatchedAfterOf(threads);
+        std::vector<size_t> unchangedOf(threads, 0);
+        parallel::ForChunks(partitions, threads, [&](size_t first, size_t last, unsigned t) {
+            std::vector<uint32_t> head, next;
+            for (size_t p = first; p < last; ++p) {
+                const Entry* b = beforeEntries.data() + beforeStart[p];
+                const size_t m = beforeStart[p + 1] - beforeStart[p];
+
+                size_t buckets = 16;
+                while (buckets < m * 2)
+                    buckets <<= 1;
+                const uint32_t mask = uint32_t(buckets - 1);
+                head.assign(buckets, none);
+                next.resize(m);
+
+                // Insert in reverse, so each chain lists objects in index order.
+                for (size_t k = m; k-- > 0;) {
+                    uint32_t& bucket = head[b[k].hash & mask];
+                    next[k] = bucket;
+                    bucket = uint32_t(k);
+                }
+
+                for (size_t a = afterStart[p]; a < afterStart[p + 1]; ++a) {
+                    const Entry& entry = afterEntries[a];
+                    uint32_t* link = &head[entry.hash & mask];
+                    while (*link != none && !(b[*link].hash == entry.hash && SameKey(b[*link], entry, scale)))
+                        link = &next[*link];
+
+                    if (*link == none) {
+                        unmatchedAfterOf[t].push_back(entry.index);
+                        continue;
+                    }
+
+                    // Unlink the match, so it is never visited again.
+                    matchedBefore[b[*link].index] = 1;
+                    *link = next[*link];
+                    ++unchangedOf[t];
+                }
+            }
+        });
+
+        std::vector<uint32_t> unmatchedAfter;
+        for (unsigned t = 0; t < threads; ++t) {
+            diff.unchanged += unchangedOf[t];
+            unmatchedAfter.insert(unmatchedAfter.end(), unmatchedAfterOf[t].begin(), unmatchedAfterOf[t].end());
+        }
+        std::sort(unmatchedAfter.begin(), unmatchedAfter.end());
+
+        // Pass 2: nearest unmatched object of the same type for what is left.
+        std::vector<uint32_t> unmatchedBefore;
+        std::vector<float> xs, ys, zs;
+        for (size_t i = 0; i < before.size(); ++i) {
+            if (!matchedBefore[i]) {
+                unmatchedBefore.push_back(uint32_t(i));
+                xs.push_back(before.xs()[i]);
+                ys.push_back(before.ys()[i]);
+                zs.push_back(before.zs()[i]);
+            }
+        }
+
+        const SpatialGrid grid(xs.data(), ys.data(), zs.data(), xs.size(), moveRadius);
+        for (uint32_t j : unmatchedAfter) {
+            const PDLObject o = after[j];
+            size_t best = none;
+            float bestDistanceSq = std::numeric_limits<float>::infinity();
+            grid.queryRadius(o.x, o.y, o.z, moveRadius, [&](size_t slot) {
+                const uint32_t i = unmatchedBefore[slot];
+                if (matchedBefore[i] || before.types()[i] != o.type)
+                    return;
+                const float dx = xs[slot] - o.x, dy = ys[slot] - o.y, dz = zs[slot] - o.z;
+                const float distanceSq = dx * dx + dy * dy + dz * dz;
+                if (distanceSq < bestDistanceSq || (distanceSq == bestDistanceSq && slot < best)) {
+                    best = slot;
+                    bestDistanceSq = distanceSq;
+                }
+            });
+
+            if (best == none) {
+                diff.added.push_back(j);
+                continue;
+            }
+
+            const uint32_t i = unmatchedBefore[best];
+            matchedBefore[i] = 1;
+            // Neighbours across a quantization step boundary are still the same position.
+            if (bestDistanceSq <= tolerance * tolerance)
+                ++diff.unchanged;
+            else
+                diff.moved.push_back({i, j});
+        }
+
+        for (uint32_t i : unmatchedBefore) {
+            if (!matchedBefore[i])
+                diff.removed.push_back(i);
+        }
+
+        return diff;
+    }
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "ObjectTable.h"
+#include "Parallel.h"
+#include "RadixSort.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+namespace morton {
+
+    const unsigned bitsPerAxis = 21;
+
+    // Spreads the low 21 bits of v so that bit i lands on bit 3i.
+    inline uint64_t Spread3(uint64_t v) {
+#if defined(__BMI2__)
+        return _pdep_u64(v, 0x1249249249249249ull);
+#else
+        v &= 0x1FFFFF;
+        v = (v | v << 32) & 0x1F00000000FFFFull;
+        v = (v | v << 16) & 0x1F0000FF0000FFull;
+        v = (v | v << 8)  & 0x100F00F00F00F00Full;
+        v = (v | v << 4)  & 0x10C30C30C30C30C3ull;
+        v = (v | v << 2)  & 0x1249249249249249ull;
+        return v;
+#endif
+    }
+
+    // Interleaves three 21-bit cell coordinates into a 63-bit Z-order code.
+    inline uint64_t Encode(uint32_t x, uint32_t y, uint32_t z) {
+        return Spread3(x) | (Spread3(y) << 1) | (Spread3(z) << 2);
+    }
+
+    // Z-order codes of all objects on a 2^21 grid spanning the map's bounds.
+    inline std::vector<uint64_t> Codes(const ObjectTable& objects, unsigned threads = 0) {
+        const size_t n = objects.size();
+        const Bounds bounds = objects.bounds();
+        const float cells = float((1u << bitsPerAxis) - 1);
+
+        auto scaleOf = [&](float lo, float hi) { return hi > lo ? cells / (hi - lo) : 0.0f; };
+        const float sx = scaleOf(bounds.minX, bounds.maxX);
+        const float sy = scaleOf(bounds.minY, bounds.maxY);
+        const float sz = scaleOf(bounds.minZ, bounds.maxZ);
+
+        auto cellOf = [&](float v, float lo, float scale) {
+            const float c = (v - lo) * scale;
+            return uint32_t(c < cells ? c : cells);
+        };
+
+        std::vector<uint64_t> codes(n);
+        if (threads == 0)
+            threads = parallel::ThreadCount(n);
+        parallel::ForChunks(n, threads, [&](size_t begin, size_t end, unsigned) {
+            for (size_t i = begin; i < end; ++i) {
+                codes[i] = Encode(cellOf(objects.xs()[i], bounds.minX, sx),
+                                  cellOf(objects.ys()[i], bounds.minY, sy),
+                                  cellOf(objects.zs()[i], bounds.minZ, sz));
+            }
+        });
+        return codes;
+    }
+
+    // Object indices in Z-order; objects in the same cell keep their file order.
+    inline std::vector<uint32_t> Order(const ObjectTable& objects, unsigned threads = 0) {
+        std::vector<uint64_t> codes = Codes(objects, threads);
+        std::vector<uint32_t> order(objects.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            order[i] = uint32_t(i);
+
+        radixSort::SortPairs(codes, order, threads);
+        return order;
+    }
+
+}
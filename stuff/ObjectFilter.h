@@ -0,0 +1,98 @@
+#pragma once
+#include "ObjectTable.h"
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+// Object selection by type ID set and axis-aligned box, evaluated over blocks of
+// decoded columns. Per-axis ranges narrow the box, so every coordinate predicate is one
+// pair of comparisons per axis. A NaN coordinate never falls inside a restricted axis.
+class ObjectFilter {
+public:
+    // Records decoded per block before the predicates run.
+    static constexpr size_t blockSize = 64;
+
+    bool active() const { return !typeIds.empty() || boxed; }
+
+    void addType(uint32_t type) {
+        auto it = std::lower_bound(typeIds.begin(), typeIds.end(), type);
+        if (it == typeIds.end() || *it != type)
+            typeIds.insert(it, type);
+    }
+
+    void clampX(float min, float max) { clamp(box.minX, box.maxX, min, max); }
+    void clampY(float min, float max) { clamp(box.minY, box.maxY, min, max); }
+    void clampZ(float min, float max) { clamp(box.minZ, box.maxZ, min, max); }
+
+    void clampBox(const Bounds& bounds) {
+        clampX(bounds.minX, bounds.maxX);
+        clampY(bounds.minY, bounds.maxY);
+        clampZ(bounds.minZ, bounds.maxZ);
+    }
+
+    bool matches(uint32_t type, float x, float y, float z) const {
+        return matchesBox(x, y, z) && matchesType(type);
+    }
+
+    // Writes keep[i] = 1 for the selected records of a block and returns how many were
+    // selected. The box test has no branches and the type test scans short sets
+    // linearly, so both loops vectorize.
+    size_t select(const uint32_t* types, const float* xs, const float* ys, const float* zs,
+                  size_t count, uint8_t* keep) const {
+        for (size_t i = 0; i < count; ++i)
+            keep[i] = 1;
+
+        if (boxed) {
+            for (size_t i = 0; i < count; ++i)
+                keep[i] = matchesBox(xs[i], ys[i], zs[i]);
+        }
+
+        if (!typeIds.empty() && typeIds.size() <= linearTypeLimit) {
+            for (size_t i = 0; i < count; ++i) {
+                uint8_t hit = 0;
+                for (uint32_t id : typeIds)
+                    hit |= types[i] == id;
+                keep[i] &= hit;
+            }
+        } else if (!typeIds.empty()) {
+            for (size_t i = 0; i < count; ++i)
+                keep[i] &= std::binary_search(typeIds.begin(), typeIds.end(), types[i]);
+        }
+
+        size_t selected = 0;
+        for (size_t i = 0; i < count; ++i)
+            selected += keep[i];
+        return selected;
+    }
+
+private:
+    static constexpr size_t linearTypeLimit = 8;
+
+    static Bounds unbounded() {
+        const float inf = std::numeric_limits<float>::infinity();
+        return {-inf, -inf, -inf, inf, inf, inf};
+    }
+
+    void clamp(float& lo, float& hi, float min, float max) {
+        lo = std::max(lo, min);
+        hi = std::min(hi, max);
+        boxed = true;
+    }
+
+    bool matchesBox(float x, float y, float z) const {
+        if (!boxed)
+            return true;
+        return (x >= box.minX) & (x <= box.maxX) & (y >= box.minY) & (y <= box.maxY) &
+               (z >= box.minZ) & (z <= box.maxZ);
+    }
+
+    bool matchesType(uint32_t type) const {
+        return typeIds.empty() || std::binary_search(typeIds.begin(), typeIds.end(), type);
+    }
+
+    std::vector<uint32_t> typeIds;
+    Bounds box = unbounded();
+    bool boxed = false;
+};
@@ -0,0 +1,154 @@
+#pragma once
+#include "AlignedAllocator.h"
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include <memory_resource>
+#include <algorithm>
+
+// Type and position only. A record's byte offset follows from its index, the table
+// start and the stride, so it is computed on demand instead of stored.
+struct PDLObject {
+    uint32_t type;
+    float x, y, z;
+};
+
+static_assert(sizeof(PDLObject) == 16, "PDLObject must stay 16 bytes");
+
+struct Bounds {
+    float minX, minY, minZ;
+    float maxX, maxY, maxZ;
+
+    // Inverted bounds that any point extends.
+    static Bounds empty() {
+        const float inf = std::numeric_limits<float>::infinity();
+        return {inf, inf, inf, -inf, -inf, -inf};
+    }
+
+    void extend(float x, float y, float z) {
+        minX = x < minX ? x : minX;
+        minY = y < minY ? y : minY;
+        minZ = z < minZ ? z : minZ;
+        maxX = x > maxX ? x : maxX;
+        maxY = y > maxY ? y : maxY;
+        maxZ = z > maxZ ? z : maxZ;
+    }
+};
+
+// Structure-of-arrays object storage. Each field lives in its own aligned column, so
+// a pass over coordinates or types reads only the bytes it needs. Byte offsets come
+// from one segment per decoded table instead of a per-object column.
+class ObjectTable {
+public:
+    explicit ObjectTable(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : typeColumn(resource), xColumn(resource), yColumn(resource), zColumn(resource), segments(resource) {}
+
+    size_t size() const { return typeColumn.size(); }
+    bool empty() const { return typeColumn.empty(); }
+
+    void reserve(size_t count) {
+        typeColumn.reserve(count);
+        xColumn.reserve(count);
+        yColumn.reserve(count);
+        zColumn.reserve(count);
+    }
+
+    void resize(size_t count) {
+        typeColumn.resize(count);
+        xColumn.resize(count);
+        yColumn.resize(count);
+        zColumn.resize(count);
+    }
+
+    void push_back(const PDLObject& obj) {
+        typeColumn.push_back(obj.type);
+        xColumn.push_back(obj.x);
+        yColumn.push_back(obj.y);
+        zColumn.push_back(obj.z);
+    }
+
+    void set(size_t index, const PDLObject& obj) {
+        typeColumn[index] = obj.type;
+        xColumn[index] = obj.x;
+        yColumn[index] = obj.y;
+        zColumn[index] = obj.z;
+    }
+
+    PDLObject operator[](size_t index) const {
+        return {typeColumn[index], xColumn[index], yColumn[index], zColumn[index]};
+    }
+
+    // Objects from firstIndex on were read from offset onwards, one every stride bytes.
+    // Segments must be added in increasing firstIndex order.
+    void addSegment(size_t firstIndex, size_t offset, size_t stride) {
+        segments.push_back({firstIndex, offset, stride});
+    }
+
+    size_t offset(size_t index) const {
+        const Segment& segment = segmentOf(index);
+        return segment.offset + (index - segment.firstIndex) * segment.stride;
+    }
+
+    // Size of the record an object was read from.
+    size_t stride(size_t index) const { return segmentOf(index).stride; }
+
+    uint32_t* types() { return typeColumn.data(); }
+    float* xs() { return xColumn.data(); }
+    float* ys() { return yColumn.data(); }
+    float* zs() { return zColumn.data(); }
+
+    const uint32_t* types() const { return typeColumn.data(); }
+    const float* xs() const { return xColumn.data(); }
+    const float* ys() const { return yColumn.data(); }
+    const float* zs() const { return zColumn.data(); }
+
+    size_t countType(uint32_t type) const {
+        const uint32_t* types = this->types();
+        size_t count = 0;
+        for (size_t i = 0; i < size(); ++i)
+            count += types[i] == type;
+        return count;
+    }
+
+    Bounds bounds() const {
+        Bounds b = Bounds::empty();
+        columnRange(xs(), b.minX, b.maxX);
+        columnRange(ys(), b.minY, b.maxY);
+        columnRange(zs(), b.minZ, b.maxZ);
+        return b;
+    }
+
+private:
+    // Branch-free min/max so the loop vectorizes.
+    void columnRange(const float* column, float& minOut, float& maxOut) const {
+        float lo = minOut, hi = maxOut;
+        for (size_t i = 0; i < size(); ++i) {
+            lo = column[i] < lo ? column[i] : lo;
+            hi = column[i] > hi ? column[i] : hi;
+        }
+        minOut = lo;
+        maxOut = hi;
+    }
+
+    AlignedVector<uint32_t> typeColumn;
+    AlignedVector<float> xColumn;
+    AlignedVector<float> yColumn;
+    AlignedVector<float> zColumn;
+
+    struct Segment {
+        size_t firstIndex;
+        size_t offset;
+        size_t stride;
+    };
+    std::pmr::vector<Segment> segments;
+
+    const Segment& segmentOf(size_t index) const {
+        auto it = std::upper_bound(segments.begin(), segments.end(), index,
+            [](size_t i, const Segment& segment) { return i < segment.firstIndex; });
+        if (it == segments.begin())
+            throw std::out_of_range("Object has no recorded offset");
+        return *--it;
+    }
+};
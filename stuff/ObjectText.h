@@ -0,0 +1,115 @@
+#pragma once
+#include "ObjectTable.h"
+#include "Parallel.h"
+#include <charconv>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include <exception>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// Reader for the extraction format: one "<type_id> <type_name> <x> <y> <z>" line per
+// object. Empty lines and lines starting with '#' (column, table and group headers)
+// are skipped; the type name is not needed to rebuild a record and is ignored.
+namespace objectText {
+
+    inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    inline const char* SkipSpaces(const char* p, const char* end) {
+        while (p < end && IsSpace(*p))
+            ++p;
+        return p;
+    }
+
+    [[noreturn]] inline void MalformedLine(const char* line, const char* end) {
+        throw std::runtime_error("Malformed object line: " + std::string(line, end));
+    }
+
+    // Parses one line, without its newline. Returns false for lines to skip and throws
+    // on malformed ones.
+    inline bool ParseLine(const char* line, const char* end, PDLObject& out) {
+        const char* p = SkipSpaces(line, end);
+        if (p == end || *p == '#')
+            return false;
+
+        auto typeResult = std::from_chars(p, end, out.type);
+        if (typeResult.ec != std::errc() || typeResult.ptr == end || !IsSpace(*typeResult.ptr))
+            MalformedLine(line, end);
+
+        // The name is a single token.
+        p = SkipSpaces(typeResult.ptr, end);
+        while (p < end && !IsSpace(*p))
+            ++p;
+
+        for (float* value : {&out.x, &out.y, &out.z}) {
+            p = SkipSpaces(p, end);
+            auto result = std::from_chars(p, end, *value);
+            if (result.ec != std::errc() || (result.ptr < end && !IsSpace(*result.ptr)))
+                MalformedLine(line, end);
+            p = result.ptr;
+        }
+
+        if (SkipSpaces(p, end) != end)
+            MalformedLine(line, end);
+        return true;
+    }
+
+    inline void ParseLines(const char* p, const char* end, std::vector<PDLObject>& out) {
+        while (p < end) {
+            const char* lineEnd = std::find(p, end, '\n');
+            PDLObject object;
+            if (ParseLine(p, lineEnd, object))
+                out.push_back(object);
+            p = lineEnd + (lineEnd < end);
+        }
+    }
+
+    // Splits the text into one chunk per thread, each cut just after a newline, parses
+    // the chunks concurrently and joins the objects in text order.
+    inline ObjectTable Parse(const char* data, size_t size, unsigned threads = 0,
+                             std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+        const char* end = data + size;
+        if (threads == 0)
+            threads = parallel::ThreadCount(size, 1 << 20);
+
+        std::vector<const char*> cuts(threads + 1, end);
+        cuts[0] = data;
+        for (unsigned t = 1; t < threads; ++t) {
+            const char* cut = std::max(cuts[t - 1], data + size * t / threads);
+            cut = std::find(cut, end, '\n');
+            cuts[t] = cut + (cut < end);
+        }
+
+        // A worker cannot throw across its thread, so errors are carried out and the
+        // first one, in text order, is rethrown.
+        std::vector<std::vector<PDLObject>> parsed(threads);
+        std::vector<std::exception_ptr> errors(threads);
+        parallel::ForChunks(threads, threads, [&](size_t begin, size_t, unsigned t) {
+            try {
+                ParseLines(cuts[begin], cuts[begin + 1], parsed[t]);
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        });
+        for (const auto& error : errors) {
+            if (error)
+                std::rethrow_exception(error);
+        }
+
+        size_t total = 0;
+        for (const auto& objects : parsed)
+            total += objects.size();
+
+        ObjectTable table(resource);
+        table.resize(total);
+        size_t at = 0;
+        for (const auto& objects : parsed) {
+            for (const PDLObject& object : objects)
+                table.set(at++, object);
+        }
+        return table;
+    }
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+namespace parallel {
+
+    // Worker count for n items: one per hardware thread, but no more than one per
+    // minChunk items so small inputs stay on the calling thread.
+    inline unsigned ThreadCount(size_t n, size_t minChunk = 1 << 14) {
+        const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+        const size_t useful = std::max<size_t>(1, n / minChunk);
+        return static_cast<unsigned>(std::min<size_t>(hardware, useful));
+    }
+
+    // Splits [0, n) into `threads` contiguous chunks and calls fn(begin, end, chunk)
+    // for each, on its own thread. Chunk k always covers the same range for a given
+    // n and thread count, so per-chunk results can be combined deterministically.
+    template <typename Fn>
+    void ForChunks(size_t n, unsigned threads, Fn&& fn) {
+        threads = std::max(1u, threads);
+        if (threads == 1) {
+            fn(size_t(0), n, 0u);
+            return;
+        }
+
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        for (unsigned t = 0; t < threads; ++t) {
+            const size_t begin = n * t / threads;
+            const size_t end = n * (t + 1) / threads;
+            workers.emplace_back([&fn, begin, end, t]() { fn(begin, end, t); });
+        }
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+}
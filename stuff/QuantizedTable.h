@@ -0,0 +1,162 @@
+#pragma once
+#include "ObjectTable.h"
+#include "AlignedAllocator.h"
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Compact read-only copy of an ObjectTable for keeping many maps resident. Coordinates
+// become fixed-point offsets from the map's bounding box, x, y and z side by side in
+// one 64-bit word, and types become indices into a per-map dictionary. With 16 bits
+// per axis the type index fills the spare top 16 bits, 8 bytes per object; with 21
+// bits it needs its own 16-bit column, 10 bytes per object. The float table takes 16.
+// A dequantized coordinate is off by at most half a step, plus float rounding.
+class QuantizedTable {
+public:
+    QuantizedTable(const ObjectTable& objects, unsigned bits) : fieldBits(bits) {
+        if (bits != 16 && bits != 21)
+            throw std::runtime_error("Quantized coordinates use 16 or 21 bits");
+
+        box = objects.bounds();
+        const float mins[] = {box.minX, box.minY, box.minZ};
+        const float maxs[] = {box.maxX, box.maxY, box.maxZ};
+        const uint32_t levels = fieldMask();
+        for (int axis = 0; axis < 3; ++axis) {
+            origin[axis] = objects.empty() ? 0.0f : mins[axis];
+            const double extent = objects.empty() ? 0.0 : double(maxs[axis]) - double(mins[axis]);
+            step[axis] = extent > 0.0 ? float(extent / levels) : 1.0f;
+        }
+
+        const size_t n = objects.size();
+        packed.resize(n);
+        if (bits == 21)
+            typeIndices.resize(n);
+
+        const float* columns[] = {objects.xs(), objects.ys(), objects.zs()};
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t word = 0;
+            for (int axis = 0; axis < 3; ++axis) {
+                const double q = std::floor((double(columns[axis][i]) - origin[axis]) / step[axis] + 0.5);
+                word |= uint64_t(std::min<double>(std::max(q, 0.0), levels)) << (axis * bits);
+            }
+
+            const uint64_t typeIndex = indexOf(objects.types()[i]);
+            if (bits == 16)
+                word |= typeIndex << 48;
+            else
+                typeIndices[i] = uint16_t(typeIndex);
+            packed[i] = word;
+        }
+    }
+
+    size_t size() const { return packed.size(); }
+    unsigned bits() const { return fieldBits; }
+    const Bounds& bounds() const { return box; }
+    size_t typeCount() const { return dictionary.size(); }
+
+    // Distance between neighbouring representable values on an axis (0 = x).
+    float stepSize(int axis) const { return step[axis]; }
+
+    size_t bytesPerObject() const { return sizeof(uint64_t) + (fieldBits == 21 ? sizeof(uint16_t) : 0); }
+    size_t memoryBytes() const {
+        return size() * bytesPerObject() + dictionary.size() * (sizeof(uint32_t) + sizeof(uint16_t));
+    }
+
+    uint32_t type(size_t index) const {
+        return dictionary[fieldBits == 16 ? size_t(packed[index] >> 48) : typeIndices[index]];
+    }
+
+    PDLObject operator[](size_t index) const {
+        const uint64_t word = packed[index];
+        return {type(index), coordinate(word, 0), coordinate(word, 1), coordinate(word, 2)};
+    }
+
+    // Expands the coordinates of objects begin .. begin + count into float columns,
+    // four objects per step with SSE2.
+    void dequantize(size_t begin, size_t count, float* xs, float* ys, float* zs) const {
+        const uint64_t* words = packed.data() + begin;
+        size_t i = 0;
+
+#if defined(__SSE2__)
+        const __m128i mask = _mm_set1_epi64x(int64_t(fieldMask()));
+        const __m128i shiftY = _mm_cvtsi32_si128(int(fieldBits));
+        const __m128i shiftZ = _mm_cvtsi32_si128(int(fieldBits * 2));
+        const __m128 originX = _mm_set1_ps(origin[0]), stepX = _mm_set1_ps(step[0]);
+        const __m128 originY = _mm_set1_ps(origin[1]), stepY = _mm_set1_ps(step[1]);
+        const __m128 originZ = _mm_set1_ps(origin[2]), stepZ = _mm_set1_ps(step[2]);
+
+        // Low 32 bits of the two 64-bit lanes of a and of b, as four floats.
+        auto lanes = [](__m128i a, __m128i b) {
+            const __m128 low = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(2, 0, 2, 0));
+            return _mm_cvtepi32_ps(_mm_castps_si128(low));
+        };
+
+        for (; i + 4 <= count; i += 4) {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i + 2));
+
+            const __m128 qx = lanes(_mm_and_si128(a, mask), _mm_and_si128(b, mask));
+            const __m128 qy = lanes(_mm_and_si128(_mm_srl_epi64(a, shiftY), mask),
+                                    _mm_and_si128(_mm_srl_epi64(b, shiftY), mask));
+            const __m128 qz = lanes(_mm_and_si128(_mm_srl_epi64(a, shiftZ), mask),
+                                    _mm_and_si128(_mm_srl_epi64(b, shiftZ), mask));
+
+            _mm_storeu_ps(xs + i, _mm_add_ps(originX, _mm_mul_ps(qx, stepX)));
+            _mm_storeu_ps(ys + i, _mm_add_ps(originY, _mm_mul_ps(qy, stepY)));
+            _mm_storeu_ps(zs + i, _mm_add_ps(originZ, _mm_mul_ps(qz, stepZ)));
+        }
+#endif
+
+        for (; i < count; ++i) {
+            xs[i] = coordinate(words[i], 0);
+            ys[i] = coordinate(words[i], 1);
+            zs[i] = coordinate(words[i], 2);
+        }
+    }
+
+private:
+    static constexpr size_t maxTypes = 1 << 16;
+
+    uint32_t fieldMask() const { return (1u << fieldBits) - 1; }
+
+    float coordinate(uint64_t word, int axis) const {
+        const uint32_t q = uint32_t(word >> (axis * fieldBits)) & fieldMask();
+        return origin[axis] + float(q) * step[axis];
+    }
+
+    size_t indexOf(uint32_t type) {
+        // Maps rarely hold more than a few dozen types, so the last hit is nearly
+        // always the answer and the binary search rarely runs.
+        if (!dictionary.empty() && dictionary[lastIndex] == type)
+            return lastIndex;
+
+        auto it = std::lower_bound(sortedTypes.begin(), sortedTypes.end(), type,
+            [&](uint16_t index, uint32_t value) { return dictionary[index] < value; });
+        if (it != sortedTypes.end() && dictionary[*it] == type)
+            return lastIndex = *it;
+
+        if (dictionary.size() == maxTypes)
+            throw std::runtime_error("Too many distinct types for a quantized table");
+        lastIndex = dictionary.size();
+        sortedTypes.insert(it, uint16_t(lastIndex));
+        dictionary.push_back(type);
+        return lastIndex;
+    }
+
+    unsigned fieldBits;
+    Bounds box;
+    float origin[3];
+    float step[3];
+
+    AlignedVector<uint64_t> packed;
+    std::vector<uint16_t> typeIndices;  // 21-bit layout only
+    std::vector<uint32_t> dictionary;   // type ID of each index, in first-seen order
+    std::vector<uint16_t> sortedTypes;  // dictionary indices ordered by type ID
+    size_t lastIndex = 0;
+};
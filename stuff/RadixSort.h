@@ -0,0 +1,72 @@
+#pragma once
+#include "Parallel.h"
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <vector>
+#include <utility>
+#include <type_traits>
+
+namespace radixSort {
+
+    // Stable LSD radix sort of keys, permuting values alongside, one byte per pass.
+    // Every pass counts digits per chunk in parallel, turns the counts into
+    // digit-major, chunk-minor offsets and scatters each chunk on its own thread, so
+    // equal keys keep their input order. Passes where every key has the same digit
+    // are skipped, which matters for keys that use only their low bits.
+    template <typename Key>
+    void SortPairs(std::vector<Key>& keys, std::vector<uint32_t>& values, unsigned threads = 0) {
+        static_assert(std::is_unsigned<Key>::value, "radix sort needs unsigned keys");
+
+        const size_t n = keys.size();
+        if (n < 2)
+            return;
+        if (threads == 0)
+            threads = parallel::ThreadCount(n);
+
+        std::vector<Key> keyScratch(n);
+        std::vector<uint32_t> valueScratch(n);
+        std::vector<std::array<size_t, 256>> counts(threads);
+
+        for (unsigned shift = 0; shift < sizeof(Key) * 8; shift += 8) {
+            parallel::ForChunks(n, threads, [&](size_t begin, size_t end, unsigned t) {
+                auto& count = counts[t];
+                count.fill(0);
+                for (size_t i = begin; i < end; ++i)
+                    ++count[(keys[i] >> shift) & 0xFF];
+            });
+
+            bool trivial = false;
+            for (unsigned digit = 0; digit < 256 && !trivial; ++digit) {
+                size_t total = 0;
+                for (unsigned t = 0; t < threads; ++t)
+                    total += counts[t][digit];
+                trivial = total == n;
+            }
+            if (trivial)
+                continue;
+
+            size_t running = 0;
+            for (unsigned digit = 0; digit < 256; ++digit) {
+                for (unsigned t = 0; t < threads; ++t) {
+                    const size_t c = counts[t][digit];
+                    counts[t][digit] = running;
+                    running += c;
+                }
+            }
+
+            parallel::ForChunks(n, threads, [&](size_t begin, size_t end, unsigned t) {
+                auto& cursor = counts[t];
+                for (size_t i = begin; i < end; ++i) {
+                    const size_t to = cursor[(keys[i] >> shift) & 0xFF]++;
+                    keyScratch[to] = keys[i];
+                    valueScratch[to] = values[i];
+                }
+            });
+
+            keys.swap(keyScratch);
+            values.swap(valueScratch);
+        }
+    }
+
+}
@@ -0,0 +1,213 @@
+#pragma once
+#include "ObjectTable.h"
+#include "Parallel.h"
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+// Uniform grid over object positions in compressed sparse row form: cellStart[c] ..
+// cellStart[c + 1] index the objects of cell c, whose indices and coordinates are
+// stored contiguously in cell order. A box query visits only the overlapping cells.
+class SpatialGrid {
+public:
+    // cellSize <= 0 picks a size that puts about two objects in each occupied cell.
+    explicit SpatialGrid(const ObjectTable& objects, float cellSize = 0.0f,
+                         unsigned threads = 0) {
+        build(objects.xs(), objects.ys(), objects.zs(), objects.size(), cellSize, threads);
+    }
+
+    SpatialGrid(const float* xs, const float* ys, const float* zs, size_t count, float cellSize = 0.0f,
+                unsigned threads = 0) {
+        build(xs, ys, zs, count, cellSize, threads);
+    }
+
+    size_t cellCount() const { return cellStart.size() - 1; }
+    float cellSize() const { return cell; }
+
+    // Calls fn(index) for every object inside the box, bounds inclusive.
+    template <typename Fn>
+    void queryBox(const Bounds& box, Fn&& fn) const {
+        forEachSlot(box, [&](uint32_t slot) { fn(size_t(indices[slot])); });
+    }
+
+    // Calls fn(index) for every object within radius of (x, y, z).
+    template <typename Fn>
+    void queryRadius(float x, float y, float z, float radius, Fn&& fn) const {
+        const Bounds box = {x - radius, y - radius, z - radius, x + radius, y + radius, z + radius};
+        const float radiusSq = radius * radius;
+        forEachSlot(box, [&](uint32_t slot) {
+            const float dx = xs[slot] - x, dy = ys[slot] - y, dz = zs[slot] - z;
+            if (dx * dx + dy * dy + dz * dz <= radiusSq)
+                fn(size_t(indices[slot]));
+        });
+    }
+
+    // Calls fn(a, b, chunk) once for every pair of objects at most radius apart, a < b.
+    // Objects are visited in cell order, so consecutive queries hit the same cells. The
+    // walk is split into `threads` chunks that run concurrently; chunk tells fn which
+    // one is calling, and the order of the calls is unspecified.
+    template <typename Fn>
+    void queryPairs(float radius, unsigned threads, Fn&& fn) const {
+        const float radiusSq = radius * radius;
+        parallel::ForChunks(objectCount(), threads, [&](size_t begin, size_t end, unsigned chunk) {
+            for (size_t s = begin; s < end; ++s) {
+                const float x = xs[s], y = ys[s], z = zs[s];
+                const Bounds box = {x - radius, y - radius, z - radius, x + radius, y + radius, z + radius};
+                forEachSlot(box, [&](uint32_t slot) {
+                    const float dx = xs[slot] - x, dy = ys[slot] - y, dz = zs[slot] - z;
+                    if (slot > s && dx * dx + dy * dy + dz * dz <= radiusSq) {
+                        const size_t a = indices[s], b = indices[slot];
+                        fn(std::min(a, b), std::max(a, b), chunk);
+                    }
+                });
+            }
+        });
+    }
+
+    std::vector<size_t> box(const Bounds& box) const {
+        std::vector<size_t> result;
+        queryBox(box, [&](size_t index) { result.push_back(index); });
+        return result;
+    }
+
+    std::vector<size_t> radius(float x, float y, float z, float radius) const {
+        std::vector<size_t> result;
+        queryRadius(x, y, z, radius, [&](size_t index) { result.push_back(index); });
+        return result;
+    }
+
+private:
+    size_t objectCount() const { return indices.size(); }
+
+    // Calls fn(slot) for every stored position inside the box.
+    template <typename Fn>
+    void forEachSlot(const Bounds& box, Fn&& fn) const {
+        if (objectCount() == 0 || !(box.minX <= box.maxX && box.minY <= box.maxY && box.minZ <= box.maxZ))
+            return;
+
+        const size_t x0 = cellCoord(box.minX, origin.minX, nx), x1 = cellCoord(box.maxX, origin.minX, nx);
+        const size_t y0 = cellCoord(box.minY, origin.minY, ny), y1 = cellCoord(box.maxY, origin.minY, ny);
+        const size_t z0 = cellCoord(box.minZ, origin.minZ, nz), z1 = cellCoord(box.maxZ, origin.minZ, nz);
+
+        for (size_t cz = z0; cz <= z1; ++cz) {
+            for (size_t cy = y0; cy <= y1; ++cy) {
+                // Cells along x are adjacent in the CSR arrays, so one row is one run.
+                const size_t rowCell = (cz * ny + cy) * nx;
+                const uint32_t begin = cellStart[rowCell + x0];
+                const uint32_t end = cellStart[rowCell + x1 + 1];
+                for (uint32_t i = begin; i < end; ++i) {
+                    if (xs[i] >= box.minX && xs[i] <= box.maxX &&
+                        ys[i] >= box.minY && ys[i] <= box.maxY &&
+                        zs[i] >= box.minZ && zs[i] <= box.maxZ)
+                        fn(i);
+                }
+            }
+        }
+    }
+
+    size_t cellCoord(float v, float lo, size_t cells) const {
+        const float c = std::floor((v - lo) / cell);
+        if (!(c > 0.0f))
+            return 0;
+        return std::min(cells - 1, static_cast<size_t>(c));
+    }
+
+    void build(const float* x, const float* y, const float* z, size_t count, float cellSize, unsigned threads) {
+        origin = Bounds::empty();
+        for (size_t i = 0; i < count; ++i)
+            origin.extend(x[i], y[i], z[i]);
+
+        const double ex = count ? std::max(0.0f, origin.maxX - origin.minX) : 0.0;
+        const double ey = count ? std::max(0.0f, origin.maxY - origin.minY) : 0.0;
+        const double ez = count ? std::max(0.0f, origin.maxZ - origin.minZ) : 0.0;
+
+        cell = cellSize;
+        if (!(cell > 0.0f)) {
+            // Volume over half the object count, with flat axes left out of the volume.
+            const double extents[] = {ex, ey, ez};
+            double volume = 1.0;
+            int dims = 0;
+            for (double e : extents) {
+                if (e > 0.0) {
+                    volume *= e;
+                    ++dims;
+                }
+            }
+            cell = dims ? float(std::pow(volume / std::max(1.0, count / 2.0), 1.0 / dims)) : 1.0f;
+            if (!(cell > 0.0f))
+                cell = 1.0f;
+        }
+
+        // Never more cells than a couple per object, whatever cellSize was asked for.
+        const double maxCells = 2.0 * double(count) + 64.0;
+        while (cellsFor(ex) * cellsFor(ey) * cellsFor(ez) > maxCells)
+            cell *= 2.0f;
+
+        nx = size_t(cellsFor(ex));
+        ny = size_t(cellsFor(ey));
+        nz = size_t(cellsFor(ez));
+        const size_t cells = nx * ny * nz;
+
+        // Each chunk keeps a histogram over all cells; bound their total size.
+        if (threads == 0)
+            threads = parallel::ThreadCount(count);
+        threads = unsigned(std::max<size_t>(1, std::min<size_t>(threads, 4 * count / std::max<size_t>(1, cells))));
+
+        // Pass 1: cell of each object and a histogram per chunk.
+        std::vector<uint32_t> cellOf(count);
+        std::vector<std::vector<uint32_t>> histograms(threads, std::vector<uint32_t>(cells, 0));
+        parallel::ForChunks(count, threads, [&](size_t begin, size_t end, unsigned t) {
+            auto& histogram = histograms[t];
+            for (size_t i = begin; i < end; ++i) {
+                const size_t c = (cellCoord(z[i], origin.minZ, nz) * ny + cellCoord(y[i], origin.minY, ny)) * nx
+                               + cellCoord(x[i], origin.minX, nx);
+                cellOf[i] = uint32_t(c);
+                ++histogram[c];
+            }
+        });
+
+        // Prefix sums: cell starts, and within each cell the start of every chunk, so
+        // the scatter keeps objects of a cell in their original order.
+        cellStart.assign(cells + 1, 0);
+        uint32_t running = 0;
+        for (size_t c = 0; c < cells; ++c) {
+            cellStart[c] = running;
+            for (unsigned t = 0; t < threads; ++t) {
+                const uint32_t n = histograms[t][c];
+                histograms[t][c] = running;
+                running += n;
+            }
+        }
+        cellStart[cells] = running;
+
+        // Pass 2: scatter indices and coordinates into cell order.
+        indices.resize(count);
+        xs.resize(count);
+        ys.resize(count);
+        zs.resize(count);
+        parallel::ForChunks(count, threads, [&](size_t begin, size_t end, unsigned t) {
+            auto& cursor = histograms[t];
+            for (size_t i = begin; i < end; ++i) {
+                const uint32_t slot = cursor[cellOf[i]]++;
+                indices[slot] = uint32_t(i);
+                xs[slot] = x[i];
+                ys[slot] = y[i];
+                zs[slot] = z[i];
+            }
+        });
+    }
+
+    double cellsFor(double extent) const {
+        return std::max(1.0, std::floor(extent / cell) + 1.0);
+    }
+
+    Bounds origin = Bounds::empty();
+    float cell = 1.0f;
+    size_t nx = 1, ny = 1, nz = 1;
+
+    std::vector<uint32_t> cellStart = {0};
+    std::vector<uint32_t> indices;
+    AlignedVector<float> xs, ys, zs;
+};
@@ -0,0 +1,197 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <algorithm>
+
+// Maps object type IDs to names. Names are interned in one pool and handed out as
+// string_views, and lookups go through a perfect hash (hash and displace) rebuilt
+// whenever types are added, so naming a record costs two hashes and no allocation.
+class TypeRegistry {
+public:
+    TypeRegistry() {
+        for (const auto& type : builtinTypes)
+            add(type.id, type.name);
+        build();
+    }
+
+    // The lookup table holds views into the pool, so the registry stays in place.
+    TypeRegistry(const TypeRegistry&) = delete;
+    TypeRegistry& operator=(const TypeRegistry&) = delete;
+
+    // Adds "<type_id> <name>" lines from a data file; '#' starts a comment line.
+    void load(const std::string& filename) {
+        std::ifstream file(filename);
+        if (!file) throw std::runtime_error("Failed to open type registry " + filename);
+
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            std::istringstream fields(line);
+            uint32_t id;
+            std::string name, extra;
+            if (!(fields >> id >> name) || (fields >> extra))
+                throw std::runtime_error("Malformed type registry line: " + line);
+
+            add(id, name);
+        }
+
+        build();
+    }
+
+    std::string_view name(uint32_t type) const {
+        const size_t slot = slotOf(type);
+        return slotUsed[slot] && slotTypes[slot] == type ? slotNames[slot] : std::string_view(defaultName);
+    }
+
+    bool contains(uint32_t type) const {
+        const size_t slot = slotOf(type);
+        return slotUsed[slot] && slotTypes[slot] == type;
+    }
+
+    size_t size() const { return entries.size(); }
+
+private:
+    struct BuiltinType {
+        uint32_t id;
+        std::string_view name;
+    };
+
+    static constexpr BuiltinType builtinTypes[] = {
+        {3274399645u, "Vehicle"},
+    };
+
+    static constexpr const char* defaultName = "Object";
+
+    struct Entry {
+        size_t nameOffset;
+        size_t nameLength;
+    };
+
+    static uint32_t mix(uint32_t key, uint32_t seed) {
+        uint32_t h = key ^ (seed * 0x9E3779B9u);
+        h ^= h >> 16;
+        h *= 0x85EBCA6Bu;
+        h ^= h >> 13;
+        h *= 0xC2B2AE35u;
+        h ^= h >> 16;
+        return h;
+    }
+
+    size_t slotOf(uint32_t type) const {
+        const uint32_t seed = seeds[mix(type, 0) & (seeds.size() - 1)];
+        return mix(type, seed) & (slotTypes.size() - 1);
+    }
+
+    void add(uint32_t id, std::string_view name) {
+        auto interned = internedNames.find(std::string(name));
+        size_t offset;
+        if (interned != internedNames.end()) {
+            offset = interned->second;
+        } else {
+            offset = pool.size();
+            pool.append(name);
+            internedNames.emplace(std::string(name), offset);
+        }
+        entries[id] = {offset, name.size()};
+    }
+
+    static size_t nextPowerOfTwo(size_t n) {
+        size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    // Groups keys into buckets by one hash, then finds per bucket (largest first) a
+    // seed that sends all of its keys to free slots. Doubles the slot count if a
+    // bucket cannot be placed.
+    void build() {
+        std::vector<uint32_t> keys;
+        for (const auto& entry : entries)
+            keys.push_back(entry.first);
+
+        size_t slotCount = nextPowerOfTwo(std::max<size_t>(1, keys.size()));
+        const size_t bucketCount = nextPowerOfTwo(std::max<size_t>(1, keys.size() / 2));
+
+        std::vector<std::vector<uint32_t>> buckets(bucketCount);
+        for (uint32_t key : keys)
+            buckets[mix(key, 0) & (bucketCount - 1)].push_back(key);
+
+        std::vector<size_t> order(bucketCount);
+        for (size_t i = 0; i < bucketCount; ++i)
+            order[i] = i;
+        std::sort(order.begin(), order.end(),
+            [&](size_t a, size_t b) { return buckets[a].size() > buckets[b].size(); });
+
+        while (!place(buckets, order, slotCount))
+            slotCount *= 2;
+
+        slotNames.assign(slotCount, std::string_view());
+        for (size_t slot = 0; slot < slotCount; ++slot) {
+            if (slotUsed[slot]) {
+                const Entry& entry = entries.at(slotTypes[slot]);
+                slotNames[slot] = std::string_view(pool).substr(entry.nameOffset, entry.nameLength);
+            }
+        }
+    }
+
+    bool place(const std::vector<std::vector<uint32_t>>& buckets, const std::vector<size_t>& order,
+               size_t slotCount) {
+        const uint32_t maxSeed = 1u << 16;
+
+        seeds.assign(buckets.size(), 0);
+        slotTypes.assign(slotCount, 0);
+        slotUsed.assign(slotCount, 0);
+
+        std::vector<size_t> taken;
+        for (size_t b : order) {
+            const auto& bucket = buckets[b];
+            if (bucket.empty())
+                break;
+
+            bool placed = false;
+            for (uint32_t seed = 1; seed < maxSeed && !placed; ++seed) {
+                taken.clear();
+                placed = true;
+                for (uint32_t key : bucket) {
+                    const size_t slot = mix(key, seed) & (slotCount - 1);
+                    if (slotUsed[slot] || std::find(taken.begin(), taken.end(), slot) != taken.end()) {
+                        placed = false;
+                        break;
+                    }
+                    taken.push_back(slot);
+                }
+
+                if (placed) {
+                    seeds[b] = seed;
+                    for (size_t i = 0; i < bucket.size(); ++i) {
+                        slotTypes[taken[i]] = bucket[i];
+                        slotUsed[taken[i]] = 1;
+                    }
+                }
+            }
+
+            if (!placed)
+                return false;
+        }
+
+        return true;
+    }
+
+    std::string pool;
+    std::unordered_map<std::string, size_t> internedNames;
+    std::unordered_map<uint32_t, Entry> entries;
+
+    std::vector<uint32_t> seeds;
+    std::vector<uint32_t> slotTypes;
+    std::vector<uint8_t> slotUsed;
+    std::vector<std::string_view> slotNames;
+};